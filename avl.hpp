@@ -19,12 +19,51 @@
  * GNU General Public License for more details.
  */
 
+#include <stdint.h>
 #include <stdlib.h>
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <new>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#endif
 
 #ifndef _AVL_RANK_TREE_HPP
 #define _AVL_RANK_TREE_HPP
 
+/*
+ * Define AVL_ENABLE_PREFETCH before including to prefetch the grandchildren (and the children rank info) of
+ * every node visited by the lookups, one level ahead, hiding part of the memory latency of trees larger than
+ * the cache.
+ */
+#if defined(AVL_ENABLE_PREFETCH) && defined(__GNUC__)
+#define AVL_PREFETCH_ENABLED 1
+#define AVL_PREFETCH(address) __builtin_prefetch(address)
+#else
+#define AVL_PREFETCH_ENABLED 0
+#define AVL_PREFETCH(address) ((void) sizeof(address))
+#endif
+
+#if __cplusplus >= 201703L
+#define AVL_IF_CONSTEXPR if constexpr
+#else
+#define AVL_IF_CONSTEXPR if
+#endif
+
+#if defined(__cpp_concepts) && __cpp_concepts >= 201907L
+#include <concepts>
+#define AVL_TREE_POLICY AVL::TreePolicyConcept
+#else
+#define AVL_TREE_POLICY class
+#endif
+
 namespace AVL {
     typedef enum {
         LESS_THAN = -1, EQUAL = 0, GREATER_THAN = 1
@@ -34,9 +73,46 @@ namespace AVL {
         ROOT, LEFT_CHILD, RIGHT_CHILD
     } NODE_POSITION;
 
+    typedef enum {
+        DEFAULT_PAGES, TRANSPARENT_HUGE_PAGES, EXPLICIT_HUGE_PAGES
+    } ARENA_PAGES;
+
+    typedef enum {
+        ORDER_VIOLATION, HEIGHT_MISMATCH, BALANCE_VIOLATION, PARENT_MISMATCH, RANK_MISMATCH, SIZE_MISMATCH,
+        MIN_NODE_MISMATCH, MAX_NODE_MISMATCH
+    } VALIDATION_ERROR;
+
     class InvalidRankInfo : public std::exception {
     };
 
+    template<bool ParentPointers, bool MinMaxCache, bool RankAugmentation, bool OperationStats>
+    class TreePolicy;
+
+    /* The feature set of AVLRankTree (parent pointers, cached min/max and rank information). */
+    typedef TreePolicy<true, true, true, false> RankTreePolicy;
+
+    /* Plain ordered map: no parent pointers, no cached min/max, no rank information, no stats. */
+    typedef TreePolicy<false, false, false, false> OrderedMapPolicy;
+
+#if defined(__cpp_concepts) && __cpp_concepts >= 201907L
+    template<class Policy>
+    concept TreePolicyConcept = requires {
+        { Policy::parent_pointers } -> std::convertible_to<bool>;
+        { Policy::min_max_cache } -> std::convertible_to<bool>;
+        { Policy::rank_augmentation } -> std::convertible_to<bool>;
+        { Policy::operation_stats } -> std::convertible_to<bool>;
+    };
+#endif
+
+    template<class Node, bool Enabled>
+    class PolicyParentLink;
+
+    template<class RankInfo, bool Enabled>
+    class PolicyRankLink;
+
+    template<typename Number = long long>
+    class PolicyTreeStats;
+
     template<typename Key, typename Value, typename Number = long long>
     class FilterObject;
 
@@ -46,7 +122,13 @@ namespace AVL {
     template<typename Key, typename Value, typename Number=long long>
     class DefaultRank;
 
-    template<typename Key, typename Value, class RankInfo, typename Number = long long>
+    template<typename Key, typename Value, typename Number=long long>
+    class MaxValueRank;
+
+    template<class Node, typename Key, typename Value, typename Number>
+    class NodeBody;
+
+    template<typename Key, typename Value, class RankInfo, typename Number = long long, class Policy = RankTreePolicy>
     class Node;
 
     template<typename Key, typename Value>
@@ -55,10 +137,14 @@ namespace AVL {
     template<typename Key, typename Value, typename Number=long long>
     class QueryResult;
 
+    template<typename Key, typename Value, class RankInfo, typename Number = long long, class Policy = RankTreePolicy>
+    class ValidationReport;
+
     template<typename Key, typename Value,
             typename Number = long long,
             class RankInfo=DefaultRank<Key, Value, Number>,
-            class Compare = CompareFunc<Key>>
+            class Compare = CompareFunc<Key>,
+            AVL_TREE_POLICY Policy = RankTreePolicy>
     class AVLRankTree;
 
 }
@@ -165,16 +251,230 @@ public:
 };
 
 /**
- * Class: Represents nodes inside the AVL Rank Tree.
+ * Class: Rank information with the max value of the subtree.
+ * Required by AVLRankTree::TopKInRange.
+ * @note The max value is not invertible, operator-= only updates the count.
  * @tparam Key - The type/class of the key.
- * @tparam Value - The type/class of the value.
- * @tparam RankInfo - Inherited Rank Class.
+ * @tparam Value - The type/class of the value (requires operator<).
  * @tparam Number - Class/Primitive for numbers representation.
  */
-template<typename Key, typename Value, class RankInfo, typename Number>
-class AVL::Node {
+template<typename Key, typename Value, typename Number>
+class AVL::MaxValueRank {
+public:
+    Number rank;
+    Value max_value;
+
+    MaxValueRank() :
+            rank(0),
+            max_value() {}
+
+    MaxValueRank(Key key, Value value) :
+            rank(1),
+            max_value(value) {
+        (void) key;
+    }
+
+    MaxValueRank(const MaxValueRank<Key, Value, Number> &_rank) :
+            rank(_rank.rank),
+            max_value(_rank.max_value) {}
+
+    ~MaxValueRank() {}
+
+    AVL::MaxValueRank<Key, Value, Number> &operator=(const MaxValueRank<Key, Value, Number> &_rank) {
+        this->rank = _rank.rank;
+        this->max_value = _rank.max_value;
+        return (*this);
+    }
+
+    AVL::MaxValueRank<Key, Value, Number> &operator-=(const MaxValueRank<Key, Value, Number> &_rank) {
+        this->rank -= _rank.rank;
+        return (*this);
+    }
+
+    AVL::MaxValueRank<Key, Value, Number> &operator+=(const MaxValueRank<Key, Value, Number> &_rank) {
+        if (_rank.rank == 0) {
+            return (*this);
+        }
+        if (this->rank == 0 || this->max_value < _rank.max_value) {
+            this->max_value = _rank.max_value;
+        }
+        this->rank += _rank.rank;
+        return (*this);
+    }
+
+    std::ostream &Print(std::ostream &os) const {
+        os << "{" << this->rank << ", " << this->max_value << "}";
+        return os;
+    }
+};
+
+/**
+ * Class: Compile time feature selection of an AVLRankTree.
+ * Disabled features cost neither node memory nor code, methods requiring them fail to compile.
+ * @note Operation stats are counted by the lookups as well, so such trees must not be read concurrently.
+ * @tparam ParentPointers - Nodes keep a parent pointer (required by node handle operations such as Next/Prev).
+ * @tparam MinMaxCache - The tree caches its min/max nodes (O(1) GetMin/GetMax).
+ * @tparam RankAugmentation - Nodes keep rank information (required by index and rank queries).
+ * @tparam OperationStats - The tree counts comparisons, rotations, inserts and removes.
+ */
+template<bool ParentPointers, bool MinMaxCache, bool RankAugmentation, bool OperationStats>
+class AVL::TreePolicy {
+public:
+    static const bool parent_pointers = ParentPointers;
+    static const bool min_max_cache = MinMaxCache;
+    static const bool rank_augmentation = RankAugmentation;
+    static const bool operation_stats = OperationStats;
+};
+
+/**
+ * Class: Optional node parent pointer (empty when disabled).
+ */
+template<class Node, bool Enabled>
+class AVL::PolicyParentLink {
+public:
+    Node *GetParent() const {
+        return NULL;
+    }
+
+    void SetParent(Node *) {}
+};
+
+template<class Node>
+class AVL::PolicyParentLink<Node, true> {
 public:
     Node *parent;
+
+    PolicyParentLink() :
+            parent(NULL) {}
+
+    Node *GetParent() const {
+        return this->parent;
+    }
+
+    void SetParent(Node *parent) {
+        this->parent = parent;
+    }
+};
+
+/**
+ * Class: Optional node rank information (empty when disabled).
+ */
+template<class RankInfo, bool Enabled>
+class AVL::PolicyRankLink {
+public:
+    PolicyRankLink() {}
+
+    template<typename Key, typename Value>
+    PolicyRankLink(const Key &, const Value &) {}
+
+    explicit PolicyRankLink(RankInfo *) {}
+
+    RankInfo *GetRank() const {
+        return NULL;
+    }
+
+    template<typename Key, typename Value>
+    void ResetRank(const Key &, const Value &) {}
+
+    void AddRank(const PolicyRankLink<RankInfo, Enabled> &) {}
+
+    void CopyRank(const PolicyRankLink<RankInfo, Enabled> &) {}
+
+    void DestroyRankInPlace() {}
+
+    std::ostream &PrintRank(std::ostream &os) const {
+        return os;
+    }
+};
+
+template<class RankInfo>
+class AVL::PolicyRankLink<RankInfo, true> {
+public:
+    RankInfo *rank;
+
+    PolicyRankLink() :
+            rank(new RankInfo()) {}
+
+    template<typename Key, typename Value>
+    PolicyRankLink(const Key &key, const Value &value) :
+            rank(new RankInfo(key, value)) {}
+
+    /* Uses rank information already constructed by the caller (e.g. inside an arena). */
+    explicit PolicyRankLink(RankInfo *rank) :
+            rank(rank) {}
+
+    PolicyRankLink(const PolicyRankLink<RankInfo, true> &link) :
+            rank(new RankInfo((*link.rank))) {}
+
+    ~PolicyRankLink() {
+        delete this->rank;
+    }
+
+    RankInfo *GetRank() const {
+        return this->rank;
+    }
+
+    template<typename Key, typename Value>
+    void ResetRank(const Key &key, const Value &value) {
+        (*this->rank) = RankInfo(key, value);
+    }
+
+    void AddRank(const PolicyRankLink<RankInfo, true> &link) {
+        (*this->rank) += (*link.rank);
+    }
+
+    void CopyRank(const PolicyRankLink<RankInfo, true> &link) {
+        (*this->rank) = (*link.rank);
+    }
+
+    /* Destroys rank information constructed by the caller (see the constructor above). */
+    void DestroyRankInPlace() {
+        this->rank->~RankInfo();
+        this->rank = NULL;
+    }
+
+    std::ostream &PrintRank(std::ostream &os) const {
+        os << "Rank: ";
+        this->rank->Print(os);
+        return os;
+    }
+};
+
+/**
+ * Class: Operation counters of an AVL Rank Tree (see TreePolicy).
+ * @tparam Number - Class/Primitive for numbers representation.
+ */
+template<typename Number>
+class AVL::PolicyTreeStats {
+public:
+    Number comparisons;
+    Number rotations;
+    Number inserts;
+    Number removes;
+
+    PolicyTreeStats() :
+            comparisons(0),
+            rotations(0),
+            inserts(0),
+            removes(0) {}
+
+    std::ostream &Print(std::ostream &os) const {
+        os << "{ Comparisons: " << this->comparisons << ", Rotations: " << this->rotations <<
+           ", Inserts: " << this->inserts << ", Removes: " << this->removes << " }";
+        return os;
+    }
+};
+
+/**
+ * Class: The members of every node, laid out between the optional parent pointer and rank information.
+ * @tparam Node - The node class.
+ * @tparam Key - The type/class of the key.
+ * @tparam Value - The type/class of the value.
+ * @tparam Number - Class/Primitive for numbers representation.
+ */
+template<class Node, typename Key, typename Value, typename Number>
+class AVL::NodeBody {
+public:
     Node *right_child;
     Node *left_child;
 
@@ -182,44 +482,56 @@ public:
     Value value;
     Number height;
 
-    RankInfo *rank;
-
-    Node() :
-            parent(NULL),
+    NodeBody() :
             right_child(NULL),
             left_child(NULL),
-            height(0),
-            rank(new RankInfo()) {
-    }
+            height(0) {}
 
-    Node(Key key, Value value) :
-            parent(NULL),
+    NodeBody(Key key, Value value, Number height) :
             right_child(NULL),
             left_child(NULL),
             key(key),
             value(value),
-            height(0),
-            rank(new RankInfo(key, value)) {
-    }
+            height(height) {}
+};
 
-    Node(const Node<Key, Value, RankInfo, Number> &node) :
-            parent(NULL),
-            right_child(NULL),
-            left_child(NULL),
-            key(node.key),
-            value(node.value),
-            height(node.height),
-            rank(new RankInfo((*node.rank))) {}
+/**
+ * Class: Represents nodes inside the AVL Rank Tree.
+ * The parent pointer and the rank information are base classes, empty when the policy disables them; with both
+ * enabled the layout is parent, children, key, value, height and rank.
+ * @tparam Key - The type/class of the key.
+ * @tparam Value - The type/class of the value.
+ * @tparam RankInfo - Inherited Rank Class.
+ * @tparam Number - Class/Primitive for numbers representation.
+ * @tparam Policy - Tree Policy Class (see TreePolicy).
+ */
+template<typename Key, typename Value, class RankInfo, typename Number, class Policy>
+class AVL::Node :
+        public AVL::PolicyParentLink<AVL::Node<Key, Value, RankInfo, Number, Policy>, Policy::parent_pointers>,
+        public AVL::NodeBody<AVL::Node<Key, Value, RankInfo, Number, Policy>, Key, Value, Number>,
+        public AVL::PolicyRankLink<RankInfo, Policy::rank_augmentation> {
+public:
+    Node() {}
 
-    ~Node() {
-        delete this->rank;
-    }
+    Node(Key key, Value value) :
+            AVL::NodeBody<AVL::Node<Key, Value, RankInfo, Number, Policy>, Key, Value, Number>(key, value, 0),
+            AVL::PolicyRankLink<RankInfo, Policy::rank_augmentation>(key, value) {}
+
+    /* Uses rank information already constructed by the caller (e.g. inside an arena). */
+    Node(Key key, Value value, RankInfo *rank) :
+            AVL::NodeBody<AVL::Node<Key, Value, RankInfo, Number, Policy>, Key, Value, Number>(key, value, 0),
+            AVL::PolicyRankLink<RankInfo, Policy::rank_augmentation>(rank) {}
+
+    Node(const Node<Key, Value, RankInfo, Number, Policy> &node) :
+            AVL::PolicyParentLink<AVL::Node<Key, Value, RankInfo, Number, Policy>, Policy::parent_pointers>(),
+            AVL::NodeBody<AVL::Node<Key, Value, RankInfo, Number, Policy>, Key, Value, Number>(node.key, node.value,
+                                                                                               node.height),
+            AVL::PolicyRankLink<RankInfo, Policy::rank_augmentation>(node) {}
 
     std::ostream &Print(std::ostream &os) const {
         os << "{ Key: " << this->key << ",\t";
         os << "Height:" << this->height << ",\t";
-        os << "Rank: ";
-        this->rank->Print(os);
+        this->PrintRank(os);
         os << " } \n";
         return os;
     }
@@ -270,6 +582,14 @@ public:
             result(NULL),
             total(0) {}
 
+    /* Takes over the result array (returned results are moved, never shared by two owners). */
+    QueryResult(QueryResult<Key, Value, Number> &&other) :
+            result(other.result),
+            total(other.total) {
+        other.result = NULL;
+        other.total = 0;
+    }
+
     ~QueryResult() {
         delete[] result;
     }
@@ -301,6 +621,64 @@ std::ostream &operator<<(std::ostream &os, const AVL::QueryResult<Value, Key, Nu
     return os;
 }
 
+/**
+ * Class: Represents the result of a structural validation of a tree (see AVLRankTree::Validate).
+ * @tparam Key - The type/class of the key.
+ * @tparam Value - The type/class of the value.
+ * @tparam RankInfo - Inherited Rank Class.
+ * @tparam Number - Class/Primitive for numbers representation.
+ * @tparam Policy - Tree Policy Class (see TreePolicy).
+ */
+template<typename Key, typename Value, class RankInfo, typename Number, class Policy>
+class AVL::ValidationReport {
+public:
+    class Issue {
+    public:
+        AVL::VALIDATION_ERROR error;
+        /* The offending node, NULL for tree-wide issues (size, min/max node). */
+        const AVL::Node<Key, Value, RankInfo, Number, Policy> *node;
+
+        Issue(AVL::VALIDATION_ERROR error, const AVL::Node<Key, Value, RankInfo, Number, Policy> *node) :
+                error(error),
+                node(node) {}
+    };
+
+    /* Amount of visited nodes. */
+    Number checked;
+    /* Amount of issues found, only the first ones are kept in issues. */
+    Number total_issues;
+    /* False if the traversal was cut (more nodes are reachable than the tree size). */
+    bool complete;
+    std::vector<Issue> issues;
+
+    ValidationReport() :
+            checked(0),
+            total_issues(0),
+            complete(true),
+            issues() {}
+
+    bool IsValid() const {
+        return this->total_issues == 0;
+    }
+
+    static const char *ErrorName(AVL::VALIDATION_ERROR error) {
+        static const char *const names[] = {
+                "Order Violation", "Height Mismatch", "Balance Violation", "Parent Mismatch", "Rank Mismatch",
+                "Size Mismatch", "Min Node Mismatch", "Max Node Mismatch"
+        };
+        return names[error];
+    }
+
+    std::ostream &Print(std::ostream &os) const {
+        os << "Checked Nodes: " << this->checked << (this->complete ? "" : " (incomplete)") << std::endl;
+        os << "Total Issues: " << this->total_issues << std::endl;
+        for (size_t i = 0; i < this->issues.size(); ++i) {
+            os << "--> " << ErrorName(this->issues[i].error) << " at node " << this->issues[i].node << std::endl;
+        }
+        return os;
+    }
+};
+
 /**
  * Class: Represents the entire AVL Rank Tree.
  * @tparam Key - The type/class of the key.
@@ -308,82 +686,157 @@ std::ostream &operator<<(std::ostream &os, const AVL::QueryResult<Value, Key, Nu
  * @tparam RankInfo - Inherited Rank Class.
  * @tparam Compare - Compare Function Object.
  * @tparam Number - Class/Primitive for numbers representation.
+ * @tparam Policy - Tree Policy Class (see TreePolicy), the default keeps every feature but the operation stats.
  */
-template<typename Key, typename Value, typename Number, class RankInfo, class Compare>
+template<typename Key, typename Value, typename Number, class RankInfo, class Compare, AVL_TREE_POLICY Policy>
 class AVL::AVLRankTree {
-
+protected:
     Number size;
-    AVL::Node<Key, Value, RankInfo, Number> *root;
-    AVL::Node<Key, Value, RankInfo, Number> *max_node;
-    AVL::Node<Key, Value, RankInfo, Number> *min_node;
+    AVL::Node<Key, Value, RankInfo, Number, Policy> *root;
+    /* Cached min/max nodes, NULL (and not maintained) without the min/max cache policy. */
+    AVL::Node<Key, Value, RankInfo, Number, Policy> *max_node;
+    AVL::Node<Key, Value, RankInfo, Number, Policy> *min_node;
     Compare compare;
+    mutable AVL::PolicyTreeStats<Number> stats;
+
+    /* Dispatch tags of the code paths which differ with the parent pointers and rank information policies. */
+    typedef std::integral_constant<bool, Policy::parent_pointers> ParentTag;
+    typedef std::integral_constant<bool, Policy::rank_augmentation> RankTag;
+
+    /* Longest root to leaf path of a descent (an AVL tree of 2^64 nodes is less than 94 levels high). */
+    static const int MAX_PATH = 96;
+
+    /*
+     * Approximate rank mode: amount of deferred updates (at most the bound), an open addressing set of the distinct
+     * nodes whose ancestors still hold stale rank information (so removals find theirs in O(1)), its size, and the
+     * height buckets of FlushRanks.
+     */
+    Number rank_error_bound;
+    Number pending_updates;
+    std::vector<AVL::Node<Key, Value, RankInfo, Number, Policy> *> pending_ranks;
+    size_t pending_count;
+    std::vector<std::vector<AVL::Node<Key, Value, RankInfo, Number, Policy> *> > flush_levels;
+
+    /* Storage of a node and its rank information inside the arena (see Compact). */
+    class RankedSlot {
+    public:
+        typename std::aligned_storage<sizeof(AVL::Node<Key, Value, RankInfo, Number, Policy>),
+                alignof(AVL::Node<Key, Value, RankInfo, Number, Policy>)>::type node;
+        typename std::aligned_storage<sizeof(RankInfo), alignof(RankInfo)>::type rank;
+    };
+
+    /* Storage of a node without rank information inside the arena. */
+    class PlainSlot {
+    public:
+        typename std::aligned_storage<sizeof(AVL::Node<Key, Value, RankInfo, Number, Policy>),
+                alignof(AVL::Node<Key, Value, RankInfo, Number, Policy>)>::type node;
+    };
+
+    typedef typename std::conditional<Policy::rank_augmentation, RankedSlot, PlainSlot>::type NodeSlot;
+
+    /* Contiguous node arena, free slots are chained through their node storage. */
+    NodeSlot *arena;
+    Number arena_capacity;
+    NodeSlot *arena_free;
+    /* Pages requested for the next arena, and pages/bytes actually backing the current one. */
+    ARENA_PAGES arena_request;
+    ARENA_PAGES arena_pages;
+    size_t arena_bytes;
 
     /** Rotations & Balance */
     void
-    UpdateRank(AVL::Node<Key, Value, RankInfo, Number> *target, AVL::Node<Key, Value, RankInfo, Number> *child_node1,
-               AVL::Node<Key, Value, RankInfo, Number> *child_node2) {
+    UpdateRank(AVL::Node<Key, Value, RankInfo, Number, Policy> *target,
+               AVL::Node<Key, Value, RankInfo, Number, Policy> *child_node1,
+               AVL::Node<Key, Value, RankInfo, Number, Policy> *child_node2) {
         if (!target) {
             return;
         }
-        RankInfo tmp = RankInfo(target->key, target->value);
-        (*target->rank) = tmp;
+        target->ResetRank(target->key, target->value);
 
         if (child_node1) {
-            (*target->rank) += (*child_node1->rank);
+            target->AddRank(*child_node1);
         }
         if (child_node2) {
-            (*target->rank) += (*child_node2->rank);
+            target->AddRank(*child_node2);
         }
     }
 
-    Number GetHeight(Node<Key, Value, RankInfo, Number> *node) const {
+    /* Compares two keys, counted by the operation stats policy. */
+    COMPARE_RESULT CompareKeys(const Key &key1, const Key &key2) const {
+        AVL_IF_CONSTEXPR (Policy::operation_stats) {
+            ++this->stats.comparisons;
+        }
+        return this->compare(key1, key2);
+    }
+
+    AVL::Node<Key, Value, RankInfo, Number, Policy> *MinNode() const {
+        AVL_IF_CONSTEXPR (Policy::min_max_cache) {
+            return this->min_node;
+        }
+        return this->FindMin(this->root);
+    }
+
+    AVL::Node<Key, Value, RankInfo, Number, Policy> *MaxNode() const {
+        AVL_IF_CONSTEXPR (Policy::min_max_cache) {
+            return this->max_node;
+        }
+        return this->FindMax(this->root);
+    }
+
+    Number GetHeight(Node<Key, Value, RankInfo, Number, Policy> *node) const {
         if (!node) {
             return -1;
         }
         return node->height;
     }
 
-    AVL::Node<Key, Value, RankInfo, Number> *RotateR(AVL::Node<Key, Value, RankInfo, Number> *node) {
-        Node<Key, Value, RankInfo, Number> *x = node;
-        Node<Key, Value, RankInfo, Number> *y = x->left_child;
-        Node<Key, Value, RankInfo, Number> *y_right = y->right_child;
+    AVL::Node<Key, Value, RankInfo, Number, Policy> *RotateR(AVL::Node<Key, Value, RankInfo, Number, Policy> *node) {
+        Node<Key, Value, RankInfo, Number, Policy> *x = node;
+        Node<Key, Value, RankInfo, Number, Policy> *y = x->left_child;
+        Node<Key, Value, RankInfo, Number, Policy> *y_right = y->right_child;
         y->right_child = x;
-        y->parent = x->parent;
-        x->parent = y;
+        y->SetParent(x->GetParent());
+        x->SetParent(y);
         x->left_child = y_right;
         if (y_right) {
-            y_right->parent = x;
+            y_right->SetParent(x);
         }
         x->height = (std::max(this->GetHeight(y_right), this->GetHeight(x->right_child)) + 1);
         y->height = (std::max(this->GetHeight(y->left_child), this->GetHeight(x)) + 1);
         this->UpdateRank(x, y_right, x->right_child);
         this->UpdateRank(y, y->left_child, x);
+        AVL_IF_CONSTEXPR (Policy::operation_stats) {
+            ++this->stats.rotations;
+        }
         return y;
     }
 
-    AVL::Node<Key, Value, RankInfo, Number> *RotateL(AVL::Node<Key, Value, RankInfo, Number> *node) {
-        Node<Key, Value, RankInfo, Number> *x = node;
-        Node<Key, Value, RankInfo, Number> *y = x->right_child;
-        Node<Key, Value, RankInfo, Number> *y_left = y->left_child;
+    AVL::Node<Key, Value, RankInfo, Number, Policy> *RotateL(AVL::Node<Key, Value, RankInfo, Number, Policy> *node) {
+        Node<Key, Value, RankInfo, Number, Policy> *x = node;
+        Node<Key, Value, RankInfo, Number, Policy> *y = x->right_child;
+        Node<Key, Value, RankInfo, Number, Policy> *y_left = y->left_child;
         y->left_child = x;
-        y->parent = x->parent;
-        x->parent = y;
+        y->SetParent(x->GetParent());
+        x->SetParent(y);
         x->right_child = y_left;
         if (y_left) {
-            y_left->parent = x;
+            y_left->SetParent(x);
         }
         x->height = (std::max(this->GetHeight(y_left), this->GetHeight(x->left_child)) + 1);
         y->height = (std::max(this->GetHeight(y->right_child), this->GetHeight(x)) + 1);
         this->UpdateRank(x, y_left, x->left_child);
         this->UpdateRank(y, y->right_child, x);
+        AVL_IF_CONSTEXPR (Policy::operation_stats) {
+            ++this->stats.rotations;
+        }
         return y;
     }
 
-    Number GetBalance(Node<Key, Value, RankInfo, Number> *node) const {
+    Number GetBalance(Node<Key, Value, RankInfo, Number, Policy> *node) const {
         return (this->GetHeight(node->left_child) - this->GetHeight(node->right_child));
     }
 
-    AVL::Node<Key, Value, RankInfo, Number> *Balance(AVL::Node<Key, Value, RankInfo, Number> *node) {
+    AVL::Node<Key, Value, RankInfo, Number, Policy> *Balance(AVL::Node<Key, Value, RankInfo, Number, Policy> *node) {
         // LL Case
         if (this->GetBalance(node) == 2 && this->GetBalance(node->left_child) >= 0) {
             return this->RotateR(node);
@@ -405,224 +858,866 @@ class AVL::AVLRankTree {
         return node;
     }
 
-    /** Private Methods */
+    /** Node Allocation */
 
-    AVL::Node<Key, Value, RankInfo, Number> *FindMin(AVL::Node<Key, Value, RankInfo, Number> *node) {
-        if (!node) {
-            return NULL;
-        }
-        if (!node->left_child) {
-            return node;
-        }
-        return this->FindMin(node->left_child);
+    bool InArena(const Node<Key, Value, RankInfo, Number, Policy> *node) const {
+        const uintptr_t address = reinterpret_cast<uintptr_t>(node);
+        return address >= reinterpret_cast<uintptr_t>(this->arena) &&
+               address < reinterpret_cast<uintptr_t>(this->arena + this->arena_capacity);
     }
 
-    AVL::Node<Key, Value, RankInfo, Number> *FindMax(AVL::Node<Key, Value, RankInfo, Number> *node) {
-        if (!node) {
-            return NULL;
-        }
-        if (!node->right_child) {
-            return node;
+    Node<Key, Value, RankInfo, Number, Policy> *AllocateNode(const Key &key, const Value &value) {
+        if (!this->arena_free) {
+            return new Node<Key, Value, RankInfo, Number, Policy>(key, value);
         }
-        return this->FindMax(node->right_child);
+        NodeSlot *slot = this->arena_free;
+        this->arena_free = *reinterpret_cast<NodeSlot **>(&slot->node);
+        return new(&slot->node) Node<Key, Value, RankInfo, Number, Policy>(
+                key, value, this->ConstructSlotRank(slot, key, value, RankTag()));
     }
 
-    AVL::NODE_POSITION GetNodePosition(AVL::Node<Key, Value, RankInfo, Number> *node) const {
-        Compare comparing_func;
-        if (!node->parent) {
-            return ROOT;
-        }
-        if (!node->parent->left_child) {
-            return RIGHT_CHILD;
-        }
-        if (!node->parent->right_child) {
-            return LEFT_CHILD;
-        }
-        COMPARE_RESULT result = comparing_func(node->parent->left_child->key, node->key);
+    /* Constructs the rank information of a node inside its arena slot (none without rank augmentation). */
+    static RankInfo *ConstructSlotRank(NodeSlot *slot, const Key &key, const Value &value, std::true_type) {
+        return new(&slot->rank) RankInfo(key, value);
+    }
 
-        return (result == EQUAL ? LEFT_CHILD : RIGHT_CHILD);
+    static RankInfo *ConstructSlotRank(NodeSlot *, const Key &, const Value &, std::false_type) {
+        return NULL;
     }
 
-    AVL::Node<Key, Value, RankInfo, Number> *
-    FindTraverse(AVL::Node<Key, Value, RankInfo, Number> *node, const Key key) const {
-        if (!node) {
-            return NULL;
-        }
-        Compare comparing_func;
-        COMPARE_RESULT result = comparing_func(key, node->key);
-        Node<Key, Value, RankInfo, Number> *tmp;
-        if (result == EQUAL) {
-            return node;
-        } else if (result == LESS_THAN) {
-            return this->FindTraverse(node->left_child, key);
-        }
-        return this->FindTraverse(node->right_child, key);
+    static RankInfo *CopySlotRank(NodeSlot *slot, const RankInfo *rank, std::true_type) {
+        return new(&slot->rank) RankInfo(*rank);
     }
 
-    void
-    ClosestTraverse(AVL::Node<Key, Value, RankInfo, Number> *node, const Key key,
-                    AVL::Node<Key, Value, RankInfo, Number> **result_node, COMPARE_RESULT range) const {
-        if (!node) {
-            return;
-        }
-        Compare comparing_func;
-        COMPARE_RESULT result = comparing_func(key, node->key);
-        Node<Key, Value, RankInfo, Number> *tmp;
-        if (result == EQUAL) {
-            (*result_node) = node;
-            return;
-        } else if (result == LESS_THAN) {
-            if (range == GREATER_THAN) {
-                (*result_node) = node;
+    static RankInfo *CopySlotRank(NodeSlot *, const RankInfo *, std::false_type) {
+        return NULL;
+    }
+
+    /**
+     * Allocates arena memory, backed by huge pages when requested and available.
+     * @param capacity - Amount of slots.
+     * @param bytes - Receives the mapped size (0 when allocated by operator new).
+     * @param pages - Receives the pages actually backing the memory.
+     */
+    NodeSlot *AllocateArena(Number capacity, size_t &bytes, ARENA_PAGES &pages) const {
+        const size_t size = (size_t) capacity * sizeof(NodeSlot);
+        bytes = 0;
+        pages = DEFAULT_PAGES;
+#if defined(__linux__) && defined(MAP_ANONYMOUS)
+        const size_t huge_page = (size_t) 2 << 20;
+        const size_t rounded = (size + huge_page - 1) / huge_page * huge_page;
+#if defined(MAP_HUGETLB)
+        if (this->arena_request == EXPLICIT_HUGE_PAGES) {
+            void *memory = mmap(NULL, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+                                -1, 0);
+            if (memory != MAP_FAILED) {
+                bytes = rounded;
+                pages = EXPLICIT_HUGE_PAGES;
+                return static_cast<NodeSlot *>(memory);
             }
-            return this->ClosestTraverse(node->left_child, key, result_node, range);
+            // No reserved huge pages (vm.nr_hugepages), fall back to transparent huge pages.
         }
-        if (range == LESS_THAN) {
-            (*result_node) = node;
+#endif
+#if defined(MADV_HUGEPAGE)
+        if (this->arena_request != DEFAULT_PAGES) {
+            // Over-maps by a huge page to align the start, then unmaps the unaligned head and tail.
+            char *memory = static_cast<char *>(mmap(NULL, rounded + huge_page, PROT_READ | PROT_WRITE,
+                                                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+            if (memory != MAP_FAILED) {
+                char *aligned = reinterpret_cast<char *>(
+                        (reinterpret_cast<uintptr_t>(memory) + huge_page - 1) & ~(uintptr_t) (huge_page - 1));
+                if (aligned != memory) {
+                    munmap(memory, aligned - memory);
+                }
+                munmap(aligned + rounded, (memory + huge_page) - aligned);
+                bytes = rounded;
+                if (madvise(aligned, rounded, MADV_HUGEPAGE) == 0) {
+                    pages = TRANSPARENT_HUGE_PAGES;
+                }
+                return reinterpret_cast<NodeSlot *>(aligned);
+            }
         }
-        return this->ClosestTraverse(node->right_child, key, result_node, range);
+#endif
+#endif
+        return static_cast<NodeSlot *>(::operator new(size));
     }
 
-
-    void GetRelativeRank(RankInfo &rank, Node<Key, Value, RankInfo, Number> *node,
-                         NODE_POSITION direction = LEFT_CHILD) const {
-        if (!node) {
+    static void FreeArena(NodeSlot *arena, size_t bytes) {
+#if defined(__linux__) && defined(MAP_ANONYMOUS)
+        if (bytes) {
+            munmap(arena, bytes);
             return;
         }
-        rank = (*node->rank);
-        if (node->right_child && (direction != RIGHT_CHILD)) { //LEFT_CHILD
-            rank -= *(node->right_child->rank);
-        }
-        if (node->left_child && (direction != LEFT_CHILD)) { // RIGHT_CHILD
-            rank -= *(node->left_child->rank);
+#endif
+        ::operator delete(arena);
+    }
+
+    /**
+     * Rewrites every node into a new arena in van Emde Boas order, extra slots are kept for insertions.
+     * @param capacity - Amount of arena slots (at least the tree size).
+     * @param rebuild - Also rebuild the tree to perfect balance.
+     */
+    void Relayout(Number capacity, bool rebuild) {
+        this->FlushRanks();
+        std::vector<Node<Key, Value, RankInfo, Number, Policy> *> order;
+        order.reserve(this->size);
+        if (rebuild && this->root) {
+            this->CollectInOrder(this->root, order);
+            this->root = this->RelinkBalanced(order, 0, this->size - 1, NULL);
+            order.clear();
+        }
+        this->VanEmdeBoasOrder(this->root, this->GetHeight(this->root) + 1, order);
+
+        size_t bytes = 0;
+        ARENA_PAGES pages = DEFAULT_PAGES;
+        NodeSlot *arena = (capacity > 0 ? this->AllocateArena(capacity, bytes, pages) : NULL);
+        // Copies each node into its slot; the old node's left child temporarily points to its copy.
+        for (size_t i = 0; i < order.size(); ++i) {
+            Node<Key, Value, RankInfo, Number, Policy> *node = order[i];
+            Node<Key, Value, RankInfo, Number, Policy> *copy = new(&arena[i].node) Node<Key, Value, RankInfo, Number,
+                    Policy>(node->key, node->value, this->CopySlotRank(&arena[i], node->GetRank(), RankTag()));
+            copy->height = node->height;
+            copy->left_child = node->left_child;
+            copy->right_child = node->right_child;
+            node->left_child = copy;
+        }
+        for (size_t i = 0; i < order.size(); ++i) {
+            Node<Key, Value, RankInfo, Number, Policy> *copy = reinterpret_cast<Node<Key, Value, RankInfo, Number,
+                    Policy> *>(&arena[i].node);
+            if (copy->left_child) {
+                copy->left_child = copy->left_child->left_child;
+                copy->left_child->SetParent(copy);
+            }
+            if (copy->right_child) {
+                copy->right_child = copy->right_child->left_child;
+                copy->right_child->SetParent(copy);
+            }
+        }
+        if (this->root) {
+            this->root = this->root->left_child;
+            AVL_IF_CONSTEXPR (Policy::min_max_cache) {
+                this->min_node = this->min_node->left_child;
+                this->max_node = this->max_node->left_child;
+            }
+        }
+        for (size_t i = 0; i < order.size(); ++i) {
+            this->DestroyNode(order[i]);
+        }
+        if (this->arena) {
+            FreeArena(this->arena, this->arena_bytes);
+        }
+        this->arena = arena;
+        this->arena_capacity = capacity;
+        this->arena_bytes = bytes;
+        this->arena_pages = pages;
+        // The spare slots are handed out in address order.
+        this->arena_free = NULL;
+        for (Number i = capacity; i-- > (Number) order.size();) {
+            *reinterpret_cast<NodeSlot **>(&arena[i].node) = this->arena_free;
+            this->arena_free = &arena[i];
         }
     }
 
-    Node<Key, Value, RankInfo, Number> *
-    FindIndexTraverse(Node<Key, Value, RankInfo, Number> *node, const Number &index, Number &cur_index) const {
+    /* Destroys a node without recycling its arena slot. */
+    void DestroyNode(Node<Key, Value, RankInfo, Number, Policy> *node) {
+        if (!this->InArena(node)) {
+            delete node;
+            return;
+        }
+        node->DestroyRankInPlace();
+        node->~Node<Key, Value, RankInfo, Number, Policy>();
+    }
+
+    void FreeNode(Node<Key, Value, RankInfo, Number, Policy> *node) {
+        const bool in_arena = this->InArena(node);
+        this->DestroyNode(node);
+        if (in_arena) {
+            NodeSlot *slot = reinterpret_cast<NodeSlot *>(node);
+            *reinterpret_cast<NodeSlot **>(&slot->node) = this->arena_free;
+            this->arena_free = slot;
+        }
+    }
+
+    /* Appends the nodes of a subtree (limited to a number of levels) in van Emde Boas order. */
+    void VanEmdeBoasOrder(Node<Key, Value, RankInfo, Number, Policy> *node, Number levels,
+                          std::vector<Node<Key, Value, RankInfo, Number, Policy> *> &order) const {
         if (!node) {
-            return NULL;
+            return;
         }
-        if (index == cur_index) {
-            return node;
+        if (levels == 1) {
+            order.push_back(node);
+            return;
         }
-        RankInfo rank = RankInfo();
-        if (index > cur_index) {
-            this->GetRelativeRank(rank, node->right_child);
-            cur_index += rank.rank;
-            return this->FindIndexTraverse(node->right_child, index, cur_index);
+        const Number top_levels = levels / 2;
+        this->VanEmdeBoasOrder(node, top_levels, order);
+        std::vector<Node<Key, Value, RankInfo, Number, Policy> *> bottom_roots;
+        this->CollectLevel(node, top_levels, bottom_roots);
+        for (size_t i = 0; i < bottom_roots.size(); ++i) {
+            this->VanEmdeBoasOrder(bottom_roots[i], levels - top_levels, order);
         }
-        if (node->left_child->right_child) {
-            cur_index -= node->left_child->right_child->rank->rank;
+    }
+
+    void CollectLevel(Node<Key, Value, RankInfo, Number, Policy> *node, Number depth,
+                      std::vector<Node<Key, Value, RankInfo, Number, Policy> *> &level) const {
+        // Explicit stack (right child pushed first), so deep trees do not exhaust the call stack.
+        std::vector<std::pair<Node<Key, Value, RankInfo, Number, Policy> *, Number> > stack;
+        stack.push_back(std::make_pair(node, depth));
+        while (!stack.empty()) {
+            node = stack.back().first;
+            depth = stack.back().second;
+            stack.pop_back();
+            if (!node) {
+                continue;
+            }
+            if (depth == 0) {
+                level.push_back(node);
+                continue;
+            }
+            stack.push_back(std::make_pair(node->right_child, depth - 1));
+            stack.push_back(std::make_pair(node->left_child, depth - 1));
         }
-        cur_index -= 1;
-        return this->FindIndexTraverse(node->left_child, index, cur_index);
     }
 
-    Node<Key, Value, RankInfo, Number> *InsertTraverse(Node<Key, Value, RankInfo, Number> *node, const Key key,
-                                                       const Value value) {
-        if (!node) {
-            return (new Node<Key, Value, RankInfo, Number>(key, value));
+    /* Appends the nodes of a subtree in order (explicit stack, so deep trees do not exhaust the call stack). */
+    void CollectInOrder(Node<Key, Value, RankInfo, Number, Policy> *node,
+                        std::vector<Node<Key, Value, RankInfo, Number, Policy> *> &order) const {
+        std::vector<Node<Key, Value, RankInfo, Number, Policy> *> stack;
+        while (node || !stack.empty()) {
+            for (; node; node = node->left_child) {
+                stack.push_back(node);
+            }
+            node = stack.back();
+            stack.pop_back();
+            order.push_back(node);
+            node = node->right_child;
         }
-        const COMPARE_RESULT compare_result = this->compare(key, node->key);
-        // LESS THAN
-        if (compare_result == LESS_THAN) {
-            node->left_child = this->InsertTraverse(node->left_child, key, value);
-            node->left_child->parent = node;
-        } else {
-            node->right_child = this->InsertTraverse(node->right_child, key, value);
-            node->right_child->parent = node;
+    }
+
+    /* Relinks sorted nodes into a perfectly balanced subtree. */
+    Node<Key, Value, RankInfo, Number, Policy> *
+    RelinkBalanced(std::vector<Node<Key, Value, RankInfo, Number, Policy> *> &nodes,
+                                                      Number start, Number end,
+                                                      Node<Key, Value, RankInfo, Number, Policy> *parent) {
+        if (start > end) {
+            return NULL;
         }
+        const Number middle = start + (end - start) / 2;
+        Node<Key, Value, RankInfo, Number, Policy> *node = nodes[middle];
+        node->SetParent(parent);
+        node->left_child = this->RelinkBalanced(nodes, start, middle - 1, node);
+        node->right_child = this->RelinkBalanced(nodes, middle + 1, end, node);
         node->height = (std::max(this->GetHeight(node->left_child), this->GetHeight(node->right_child)) + 1);
         this->UpdateRank(node, node->left_child, node->right_child);
-        return this->Balance(node);
+        return node;
     }
 
-    Node<Key, Value, RankInfo, Number> *RemoveTraverse(Node<Key, Value, RankInfo, Number> *node, const Key key) {
-        if (!node) {
-            return NULL;
+    /** Private Methods */
+
+    AVL::Node<Key, Value, RankInfo, Number, Policy> *
+    FindMin(AVL::Node<Key, Value, RankInfo, Number, Policy> *node) const {
+        while (node && node->left_child) {
+            node = node->left_child;
         }
-        const COMPARE_RESULT compare_result = this->compare(key, node->key);
-        switch (compare_result) {
-            case LESS_THAN:
-                node->left_child = this->RemoveTraverse(node->left_child, key);
-                if (node->left_child) {
-                    node->left_child->parent = node;
-                }
-                break;
-            case GREATER_THAN:
-                node->right_child = this->RemoveTraverse(node->right_child, key);
-                if (node->right_child) {
-                    node->right_child->parent = node;
+        return node;
+    }
+
+    AVL::Node<Key, Value, RankInfo, Number, Policy> *
+    FindMax(AVL::Node<Key, Value, RankInfo, Number, Policy> *node) const {
+        while (node && node->right_child) {
+            node = node->right_child;
+        }
+        return node;
+    }
+
+    AVL::NODE_POSITION GetNodePosition(AVL::Node<Key, Value, RankInfo, Number, Policy> *node) const {
+        Compare comparing_func;
+        if (!node->parent) {
+            return ROOT;
+        }
+        if (!node->parent->left_child) {
+            return RIGHT_CHILD;
+        }
+        if (!node->parent->right_child) {
+            return LEFT_CHILD;
+        }
+        COMPARE_RESULT result = comparing_func(node->parent->left_child->key, node->key);
+
+        return (result == EQUAL ? LEFT_CHILD : RIGHT_CHILD);
+    }
+
+    /**
+     * Issues the loads of the grandchildren (and the children rank information) while the current key is
+     * compared, so they arrive one level ahead; the children themselves were prefetched on the previous level.
+     * No-op unless enabled.
+     */
+    static void PrefetchGrandchildren(const AVL::Node<Key, Value, RankInfo, Number, Policy> *node, bool ranks = false) {
+#if AVL_PREFETCH_ENABLED
+        const AVL::Node<Key, Value, RankInfo, Number, Policy> *children[2] = {node->left_child, node->right_child};
+        for (int i = 0; i < 2; ++i) {
+            if (children[i]) {
+                AVL_PREFETCH(children[i]->left_child);
+                AVL_PREFETCH(children[i]->right_child);
+                if (ranks) {
+                    AVL_PREFETCH(children[i]->GetRank());
                 }
-                break;
-            case EQUAL:
-                if (node->left_child && node->right_child) {
-                    Node<Key, Value, RankInfo, Number> *min_val = this->FindMin(node->right_child);
-                    node->value = min_val->value;
-                    node->key = min_val->key;
-                    RankInfo *rank = new RankInfo(*min_val->rank);
-                    delete node->rank;
-                    node->rank = rank;
-                    Node<Key, Value, RankInfo, Number> *tmp = this->RemoveTraverse(node->right_child, min_val->key);
-                    node->right_child = tmp;
-                    if (tmp) {
-                        tmp->parent = node;
-                    }
-                } else if (node->left_child) {
-                    Node<Key, Value, RankInfo, Number> *temp = node->left_child;
-                    delete node;
-                    return temp;
-                } else if (node->right_child) {
-                    Node<Key, Value, RankInfo, Number> *temp = node->right_child;
-                    delete node;
-                    return temp;
-                } else { // NO CHILDREN NODES
-                    delete node;
-                    return NULL;
+            }
+        }
+#else
+        (void) node;
+        (void) ranks;
+#endif
+    }
+
+    AVL::Node<Key, Value, RankInfo, Number, Policy> *
+    FindTraverse(AVL::Node<Key, Value, RankInfo, Number, Policy> *node, const Key key) const {
+        while (node) {
+            this->PrefetchGrandchildren(node);
+            COMPARE_RESULT result = this->CompareKeys(key, node->key);
+            if (result == EQUAL) {
+                return node;
+            }
+            node = (result == LESS_THAN ? node->left_child : node->right_child);
+        }
+        return NULL;
+    }
+
+    void
+    ClosestTraverse(AVL::Node<Key, Value, RankInfo, Number, Policy> *node, const Key key,
+                    AVL::Node<Key, Value, RankInfo, Number, Policy> **result_node, COMPARE_RESULT range) const {
+        while (node) {
+            this->PrefetchGrandchildren(node);
+            COMPARE_RESULT result = this->CompareKeys(key, node->key);
+            if (result == EQUAL) {
+                (*result_node) = node;
+                return;
+            } else if (result == LESS_THAN) {
+                if (range == GREATER_THAN) {
+                    (*result_node) = node;
                 }
-                break;
+                node = node->left_child;
+                continue;
+            }
+            if (range == LESS_THAN) {
+                (*result_node) = node;
+            }
+            node = node->right_child;
         }
-        node->height = (std::max(this->GetHeight(node->left_child), this->GetHeight(node->right_child)) + 1);
-        this->UpdateRank(node, node->left_child, node->right_child);
-        return this->Balance(node);
     }
 
-    void QueryTraverse(Node<Key, Value, RankInfo, Number> *node,
-                       QueryResult<Key, Value, Number> *query,
-                       Node<Key, Value, RankInfo, Number> *result_node,
-                       const AVL::FilterObject<Key, Value, Number> &filter) const {
-        Compare compare_func;
-        COMPARE_RESULT compare_result_min;
-        COMPARE_RESULT compare_result_max;
+    /**
+     * Finds the leftmost node whose key is not less than a given key (range GREATER_THAN), or the rightmost node
+     * whose key is not greater than it (range LESS_THAN), so every duplicate of a range bound is included.
+     */
+    AVL::Node<Key, Value, RankInfo, Number, Policy> *
+    BoundTraverse(AVL::Node<Key, Value, RankInfo, Number, Policy> *node, const Key &key, COMPARE_RESULT range) const {
+        AVL::Node<Key, Value, RankInfo, Number, Policy> *bound = NULL;
+        while (node) {
+            this->PrefetchGrandchildren(node);
+            const COMPARE_RESULT result = this->CompareKeys(node->key, key);
+            if (result == EQUAL || result == range) {
+                // Within the range, keeps looking for a candidate nearer the bound (equal keys included).
+                bound = node;
+                node = (range == GREATER_THAN ? node->left_child : node->right_child);
+                continue;
+            }
+            node = (range == GREATER_THAN ? node->right_child : node->left_child);
+        }
+        return bound;
+    }
 
-        if (!node || ((filter.limit <= query->total) && filter.limit > -1)) {
+    void GetRelativeRank(RankInfo &rank, Node<Key, Value, RankInfo, Number, Policy> *node,
+                         NODE_POSITION direction = LEFT_CHILD) const {
+        if (!node) {
             return;
         }
+        rank = (*node->rank);
+        if (node->right_child && (direction != RIGHT_CHILD)) { //LEFT_CHILD
+            rank -= *(node->right_child->rank);
+        }
+        if (node->left_child && (direction != LEFT_CHILD)) { // RIGHT_CHILD
+            rank -= *(node->left_child->rank);
+        }
+    }
 
-        if (filter.min_range) {
-            compare_result_min = compare_func(node->key, (*filter.min_range));
-            if (compare_result_min == LESS_THAN) {
-                return this->QueryTraverse(node->right_child, query, result_node, filter);
+    /*
+     * Descends to the element of an index by the subtree counts. Stale counts (approximate rank mode) may lead
+     * the descent off the tree, it then ends on the last visited node, whose index is off by at most the bound.
+     */
+    Node<Key, Value, RankInfo, Number, Policy> *FindIndexTraverse(Number index) const {
+        Node<Key, Value, RankInfo, Number, Policy> *node = this->root;
+        Node<Key, Value, RankInfo, Number, Policy> *last = NULL;
+        while (node) {
+            last = node;
+            const Number left_size = node->left_child ? node->left_child->rank->rank : 0;
+            if (index == left_size) {
+                return node;
+            }
+            if (index < left_size) {
+                node = node->left_child;
+            } else {
+                index -= (left_size + 1);
+                node = node->right_child;
             }
         }
-        if (filter.max_range) {
-            compare_result_max = compare_func(node->key, (*filter.max_range));
-            if (compare_result_max == GREATER_THAN) {
-                return this->QueryTraverse(node->left_child, query, result_node, filter);
+        return last;
+    }
+
+    void ReplaceChild(Node<Key, Value, RankInfo, Number, Policy> *parent,
+                      Node<Key, Value, RankInfo, Number, Policy> *child,
+                      Node<Key, Value, RankInfo, Number, Policy> *new_child) {
+        if (new_child) {
+            new_child->SetParent(parent);
+        }
+        if (!parent) {
+            this->root = new_child;
+            return;
+        }
+        if (parent->left_child == child) {
+            parent->left_child = new_child;
+        } else {
+            parent->right_child = new_child;
+        }
+    }
+
+    void UpdateRankUpwards(Node<Key, Value, RankInfo, Number, Policy> *node) {
+        while (node) {
+            this->UpdateRank(node, node->left_child, node->right_child);
+            node = node->parent;
+        }
+    }
+
+    /* Brings the rank information of the ancestors of a node up to date (or defers it in approximate mode). */
+    void PropagateRanks(Node<Key, Value, RankInfo, Number, Policy> *node) {
+        if (this->rank_error_bound <= 0) {
+            this->UpdateRankUpwards(node);
+            return;
+        }
+        if (!node) {
+            return;
+        }
+        if (!this->IsPending(node)) {
+            this->AddPending(node);
+        }
+        if (++this->pending_updates > this->rank_error_bound) {
+            this->FlushRanks();
+        }
+    }
+
+    /* Home slot of a node in the pending set. */
+    size_t PendingHome(const Node<Key, Value, RankInfo, Number, Policy> *node) const {
+        uint64_t hash = (uint64_t) (uintptr_t) node;
+        hash = (hash ^ (hash >> 29)) * 0xbf58476d1ce4e5b9ULL;
+        return (size_t) (hash ^ (hash >> 32)) & (this->pending_ranks.size() - 1);
+    }
+
+    /* Slot of a node in the pending set, or the empty slot it would take. */
+    size_t PendingSlot(const Node<Key, Value, RankInfo, Number, Policy> *node) const {
+        const size_t mask = this->pending_ranks.size() - 1;
+        size_t slot = this->PendingHome(node);
+        while (this->pending_ranks[slot] && this->pending_ranks[slot] != node) {
+            slot = (slot + 1) & mask;
+        }
+        return slot;
+    }
+
+    bool IsPending(const Node<Key, Value, RankInfo, Number, Policy> *node) const {
+        return this->pending_count > 0 && this->pending_ranks[this->PendingSlot(node)] == node;
+    }
+
+    void AddPending(Node<Key, Value, RankInfo, Number, Policy> *node) {
+        if (4 * (this->pending_count + 1) > this->pending_ranks.size()) {
+            // Keeps the set at most a quarter full.
+            std::vector<Node<Key, Value, RankInfo, Number, Policy> *> nodes;
+            nodes.swap(this->pending_ranks);
+            this->pending_ranks.assign(std::max((size_t) 64, 2 * nodes.size()), NULL);
+            for (size_t i = 0; i < nodes.size(); ++i) {
+                if (nodes[i]) {
+                    this->pending_ranks[this->PendingSlot(nodes[i])] = nodes[i];
+                }
+            }
+        }
+        this->pending_ranks[this->PendingSlot(node)] = node;
+        ++this->pending_count;
+    }
+
+    void RemovePending(Node<Key, Value, RankInfo, Number, Policy> *node) {
+        const size_t mask = this->pending_ranks.size() - 1;
+        size_t hole = this->PendingSlot(node);
+        // Shifts back the following nodes of the probe run which may not be found past the hole otherwise.
+        for (size_t slot = (hole + 1) & mask; this->pending_ranks[slot]; slot = (slot + 1) & mask) {
+            const size_t home = this->PendingHome(this->pending_ranks[slot]);
+            if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+                this->pending_ranks[hole] = this->pending_ranks[slot];
+                hole = slot;
+            }
+        }
+        this->pending_ranks[hole] = NULL;
+        --this->pending_count;
+    }
+
+    void RebalanceUpwards(Node<Key, Value, RankInfo, Number, Policy> *node) {
+        while (node) {
+            Node<Key, Value, RankInfo, Number, Policy> *parent = node->parent;
+            const Number old_height = node->height;
+            node->height = (std::max(this->GetHeight(node->left_child), this->GetHeight(node->right_child)) + 1);
+            this->UpdateRank(node, node->left_child, node->right_child);
+            Node<Key, Value, RankInfo, Number, Policy> *top = this->Balance(node);
+            this->ReplaceChild(parent, node, top);
+            if (top == node && node->height == old_height) {
+                // Heights above are unchanged, only the rank information of the ancestors is left.
+                this->PropagateRanks(parent);
+                return;
+            }
+            node = parent;
+        }
+    }
+
+    Node<Key, Value, RankInfo, Number, Policy> *NextNode(Node<Key, Value, RankInfo, Number, Policy> *node) const {
+        if (node->right_child) {
+            node = node->right_child;
+            while (node->left_child) {
+                node = node->left_child;
+            }
+            return node;
+        }
+        while (node->parent && node->parent->right_child == node) {
+            node = node->parent;
+        }
+        return node->parent;
+    }
+
+    Node<Key, Value, RankInfo, Number, Policy> *PrevNode(Node<Key, Value, RankInfo, Number, Policy> *node) const {
+        if (node->left_child) {
+            node = node->left_child;
+            while (node->right_child) {
+                node = node->right_child;
+            }
+            return node;
+        }
+        while (node->parent && node->parent->left_child == node) {
+            node = node->parent;
+        }
+        return node->parent;
+    }
+
+    /* Updates the size, the stats and the cached min/max nodes after a node is linked. */
+    void CountInsertion(Node<Key, Value, RankInfo, Number, Policy> *node) {
+        AVL_IF_CONSTEXPR (Policy::min_max_cache) {
+            if (!this->min_node || this->compare(node->key, this->min_node->key) == LESS_THAN) {
+                this->min_node = node;
+            }
+            if (!this->max_node || this->compare(node->key, this->max_node->key) != LESS_THAN) {
+                this->max_node = node;
+            }
+        }
+        ++this->size;
+        AVL_IF_CONSTEXPR (Policy::operation_stats) {
+            ++this->stats.inserts;
+        }
+    }
+
+    /**
+     * Links a detached node as a leaf under a given parent and rebalances the path up to the root.
+     * @param node - Detached node (no parent/children).
+     * @param parent - The leaf parent found by the descent, NULL for an empty tree.
+     * @param position - The result of comparing the node key against the parent key.
+     */
+    void LinkNode(Node<Key, Value, RankInfo, Number, Policy> *node, Node<Key, Value, RankInfo, Number, Policy> *parent,
+                  COMPARE_RESULT position) {
+        node->parent = parent;
+        node->left_child = NULL;
+        node->right_child = NULL;
+        node->height = 0;
+        this->UpdateRank(node, NULL, NULL);
+        if (!parent) {
+            this->root = node;
+        } else if (position == LESS_THAN) {
+            parent->left_child = node;
+        } else {
+            parent->right_child = node;
+        }
+        this->CountInsertion(node);
+        this->RebalanceUpwards(parent);
+    }
+
+    /**
+     * Links a detached node as a leaf at the end of a descent path and rebalances the path (no parent pointers).
+     * @param node - Detached node (no children).
+     * @param path - The nodes from the root down to the leaf parent.
+     * @param depth - Length of the path, 0 for an empty tree.
+     * @param position - The result of comparing the node key against the leaf parent key.
+     */
+    void LinkPath(Node<Key, Value, RankInfo, Number, Policy> *node, Node<Key, Value, RankInfo, Number, Policy> **path,
+                  int depth, COMPARE_RESULT position) {
+        node->left_child = NULL;
+        node->right_child = NULL;
+        node->height = 0;
+        this->UpdateRank(node, NULL, NULL);
+        if (depth == 0) {
+            this->root = node;
+        } else if (position == LESS_THAN) {
+            path[depth - 1]->left_child = node;
+        } else {
+            path[depth - 1]->right_child = node;
+        }
+        this->CountInsertion(node);
+        this->RebalancePath(path, depth);
+    }
+
+    /* Rebalances a descent path bottom-up, the counterpart of RebalanceUpwards without parent pointers. */
+    void RebalancePath(Node<Key, Value, RankInfo, Number, Policy> **path, int depth) {
+        while (depth-- > 0) {
+            Node<Key, Value, RankInfo, Number, Policy> *node = path[depth];
+            const Number old_height = node->height;
+            node->height = (std::max(this->GetHeight(node->left_child), this->GetHeight(node->right_child)) + 1);
+            this->UpdateRank(node, node->left_child, node->right_child);
+            Node<Key, Value, RankInfo, Number, Policy> *top = this->Balance(node);
+            this->ReplaceChild(depth > 0 ? path[depth - 1] : NULL, node, top);
+            if (top == node && node->height == old_height) {
+                // Heights above are unchanged, only the rank information of the ancestors is left.
+                this->UpdateRankPath(path, depth);
+                return;
+            }
+        }
+    }
+
+    void UpdateRankPath(Node<Key, Value, RankInfo, Number, Policy> **path, int depth) {
+        AVL_IF_CONSTEXPR (Policy::rank_augmentation) {
+            while (depth-- > 0) {
+                this->UpdateRank(path[depth], path[depth]->left_child, path[depth]->right_child);
+            }
+        }
+    }
+
+    /**
+     * Descends to a key, recording the path.
+     * @param path - Receives the nodes from the root down to the found node (or to the last visited node).
+     * @param depth - Receives the length of the path.
+     * @return {Node<Key, Value, RankInfo, Number, Policy>} the found node or NULL.
+     */
+    Node<Key, Value, RankInfo, Number, Policy> *
+    FindPath(const Key &key, Node<Key, Value, RankInfo, Number, Policy> **path, int &depth) const {
+        depth = 0;
+        for (Node<Key, Value, RankInfo, Number, Policy> *node = this->root; node;) {
+            path[depth++] = node;
+            const COMPARE_RESULT result = this->CompareKeys(key, node->key);
+            if (result == EQUAL) {
+                return node;
+            }
+            node = (result == LESS_THAN ? node->left_child : node->right_child);
+        }
+        return NULL;
+    }
+
+    /**
+     * Inserts an existing node object into the tree (equal keys are placed to the right).
+     * @param node - Detached node (no parent/children).
+     */
+    void AttachNode(Node<Key, Value, RankInfo, Number, Policy> *node) {
+        this->AttachNode(node, ParentTag());
+    }
+
+    void AttachNode(Node<Key, Value, RankInfo, Number, Policy> *node, std::true_type) {
+        Node<Key, Value, RankInfo, Number, Policy> *parent = NULL;
+        Node<Key, Value, RankInfo, Number, Policy> *current = this->root;
+        COMPARE_RESULT result = EQUAL;
+        while (current) {
+            parent = current;
+            result = this->CompareKeys(node->key, current->key);
+            current = (result == LESS_THAN ? current->left_child : current->right_child);
+        }
+        this->LinkNode(node, parent, result);
+    }
+
+    void AttachNode(Node<Key, Value, RankInfo, Number, Policy> *node, std::false_type) {
+        Node<Key, Value, RankInfo, Number, Policy> *path[MAX_PATH];
+        int depth = 0;
+        COMPARE_RESULT result = EQUAL;
+        for (Node<Key, Value, RankInfo, Number, Policy> *current = this->root; current;) {
+            path[depth++] = current;
+            result = this->CompareKeys(node->key, current->key);
+            current = (result == LESS_THAN ? current->left_child : current->right_child);
+        }
+        this->LinkPath(node, path, depth, result);
+    }
+
+    /* Updates the size and the stats after a node is unlinked. */
+    void CountRemoval() {
+        --this->size;
+        AVL_IF_CONSTEXPR (Policy::operation_stats) {
+            ++this->stats.removes;
+        }
+    }
+
+    /**
+     * Unlinks a node from the tree without deallocating it.
+     * The node object itself is never copied into, so pointers to other nodes remain valid.
+     * @param node - A node which is currently linked in the tree.
+     */
+    void DetachNode(Node<Key, Value, RankInfo, Number, Policy> *node) {
+        Node<Key, Value, RankInfo, Number, Policy> *rebalance_from;
+        if (this->IsPending(node)) {
+            // The ancestors of the node stay stale until its parent is flushed.
+            this->RemovePending(node);
+            if (node->parent && !this->IsPending(node->parent)) {
+                this->AddPending(node->parent);
             }
         }
+        AVL_IF_CONSTEXPR (Policy::min_max_cache) {
+            if (node == this->min_node) {
+                this->min_node = this->NextNode(node);
+            }
+            if (node == this->max_node) {
+                this->max_node = this->PrevNode(node);
+            }
+        }
+        if (node->left_child && node->right_child) {
+            Node<Key, Value, RankInfo, Number, Policy> *successor = this->FindMin(node->right_child);
+            if (successor->parent == node) {
+                rebalance_from = successor;
+            } else {
+                rebalance_from = successor->parent;
+                rebalance_from->left_child = successor->right_child;
+                if (successor->right_child) {
+                    successor->right_child->parent = rebalance_from;
+                }
+                successor->right_child = node->right_child;
+                successor->right_child->parent = successor;
+            }
+            successor->left_child = node->left_child;
+            successor->left_child->parent = successor;
+            // The successor takes over the height and rank information of the node position.
+            successor->height = node->height;
+            successor->CopyRank(*node);
+            this->ReplaceChild(node->parent, node, successor);
+        } else {
+            rebalance_from = node->parent;
+            this->ReplaceChild(node->parent, node, node->left_child ? node->left_child : node->right_child);
+        }
+        node->parent = NULL;
+        node->left_child = NULL;
+        node->right_child = NULL;
+        node->height = 0;
+        this->CountRemoval();
+        this->RebalanceUpwards(rebalance_from);
+    }
 
-        this->QueryTraverse(node->left_child, query, result_node, filter);
-        if (filter.limit <= -1 || (filter.limit > query->total)) {
-            if (!filter.FilterFunction || filter.FilterFunction(node->key, node->value)) {
-                result_node->left_child->right_child = new Node<Key, Value, RankInfo, Number>(node->key, node->value);
-                result_node->left_child = result_node->left_child->right_child;
-                result_node->left_child->parent = result_node->parent;
-                ++(query->total);
+    /**
+     * Unlinks the node at the end of a descent path without deallocating it (no parent pointers).
+     * @param path - The nodes from the root down to the node, reused for the successor path.
+     * @param depth - Length of the path.
+     */
+    void DetachPath(Node<Key, Value, RankInfo, Number, Policy> **path, int depth) {
+        const int index = depth - 1;
+        Node<Key, Value, RankInfo, Number, Policy> *node = path[index];
+        Node<Key, Value, RankInfo, Number, Policy> *parent = (index > 0 ? path[index - 1] : NULL);
+        if (node->left_child && node->right_child) {
+            // The successor takes over the node position, the path goes on down to the successor parent.
+            Node<Key, Value, RankInfo, Number, Policy> *successor = node->right_child;
+            depth = index + 1;
+            while (successor->left_child) {
+                path[depth++] = successor;
+                successor = successor->left_child;
+            }
+            if (depth > index + 1) {
+                path[depth - 1]->left_child = successor->right_child;
+                successor->right_child = node->right_child;
+            }
+            successor->left_child = node->left_child;
+            successor->height = node->height;
+            successor->CopyRank(*node);
+            path[index] = successor;
+            this->ReplaceChild(parent, node, successor);
+        } else {
+            depth = index;
+            this->ReplaceChild(parent, node, node->left_child ? node->left_child : node->right_child);
+        }
+        node->left_child = NULL;
+        node->right_child = NULL;
+        node->height = 0;
+        this->CountRemoval();
+        this->RebalancePath(path, depth);
+        AVL_IF_CONSTEXPR (Policy::min_max_cache) {
+            if (node == this->min_node) {
+                this->min_node = this->FindMin(this->root);
+            }
+            if (node == this->max_node) {
+                this->max_node = this->FindMax(this->root);
+            }
+        }
+    }
+
+    /* Appends a node copy to the result chain of a query, false once the walk should stop (see Query). */
+    bool QueryVisit(Node<Key, Value, RankInfo, Number, Policy> *node, QueryResult<Key, Value, Number> *query,
+                    Node<Key, Value, RankInfo, Number, Policy> *result_node,
+                    const AVL::FilterObject<Key, Value, Number> &filter) const {
+        if ((filter.limit <= query->total) && filter.limit > -1) {
+            return false;
+        }
+        if (!filter.reverse && filter.max_range && this->CompareKeys(node->key, (*filter.max_range)) == GREATER_THAN) {
+            return false;
+        }
+        if (filter.reverse && filter.min_range && this->CompareKeys(node->key, (*filter.min_range)) == LESS_THAN) {
+            return false;
+        }
+        if (!filter.FilterFunction || filter.FilterFunction(node->key, node->value)) {
+            result_node->left_child->right_child =
+                    new Node<Key, Value, RankInfo, Number, Policy>(node->key, node->value);
+            result_node->left_child = result_node->left_child->right_child;
+            result_node->left_child->SetParent(result_node->GetParent());
+            ++(query->total);
+        }
+        return true;
+    }
+
+    void QueryTraverse(Node<Key, Value, RankInfo, Number, Policy> *node,
+                       QueryResult<Key, Value, Number> *query,
+                       Node<Key, Value, RankInfo, Number, Policy> *result_node,
+                       const AVL::FilterObject<Key, Value, Number> &filter, std::true_type) const {
+        // In-order walk of the range through the successor links, so deep trees do not exhaust the call stack.
+        Node<Key, Value, RankInfo, Number, Policy> *first = NULL;
+        if (filter.reverse && filter.max_range) {
+            first = this->BoundTraverse(node, *filter.max_range, LESS_THAN);
+        } else if (filter.reverse) {
+            first = this->FindMax(node);
+        } else if (filter.min_range) {
+            first = this->BoundTraverse(node, *filter.min_range, GREATER_THAN);
+        } else {
+            first = this->FindMin(node);
+        }
+        for (node = first; node && this->QueryVisit(node, query, result_node, filter);
+             node = (filter.reverse ? this->PrevNode(node) : this->NextNode(node))) {
+        }
+    }
+
+    void QueryTraverse(Node<Key, Value, RankInfo, Number, Policy> *node,
+                       QueryResult<Key, Value, Number> *query,
+                       Node<Key, Value, RankInfo, Number, Policy> *result_node,
+                       const AVL::FilterObject<Key, Value, Number> &filter, std::false_type) const {
+        // In-order walk of the range with an explicit stack of the pending ancestors (no parent pointers), mirrored
+        // (right subtrees first) in reverse.
+        std::vector<Node<Key, Value, RankInfo, Number, Policy> *> stack;
+        const Key *bound = (filter.reverse ? filter.max_range : filter.min_range);
+        const COMPARE_RESULT outside = (filter.reverse ? GREATER_THAN : LESS_THAN);
+        while (node) {
+            if (bound && this->CompareKeys(node->key, *bound) == outside) {
+                node = (filter.reverse ? node->left_child : node->right_child);
+                continue;
+            }
+            stack.push_back(node);
+            node = (filter.reverse ? node->right_child : node->left_child);
+        }
+        while (!stack.empty()) {
+            node = stack.back();
+            stack.pop_back();
+            if (!this->QueryVisit(node, query, result_node, filter)) {
+                return;
+            }
+            for (node = (filter.reverse ? node->left_child : node->right_child); node;
+                 node = (filter.reverse ? node->right_child : node->left_child)) {
+                stack.push_back(node);
             }
         }
-        return this->QueryTraverse(node->right_child, query, result_node, filter);
     }
 
     QueryResult<Key, Value, Number> *MergeTwoQueries(QueryResult<Key, Value, Number> *first,
@@ -659,128 +1754,837 @@ class AVL::AVLRankTree {
         return result;
     }
 
-    Node<Key, Value, RankInfo, Number> *TreeFromQuery(QueryResult<Key, Value, Number> *query, Number start,
+    Node<Key, Value, RankInfo, Number, Policy> *TreeFromQuery(QueryResult<Key, Value, Number> *query, Number start,
                                                       Number end) {
         if (start > end) {
             return NULL;
         }
         Number middle = (start + end) / 2;
-        Node<Key, Value, RankInfo, Number> *root = new Node<Key, Value, RankInfo, Number>(query->result[middle].key,
-                                                                                          query->result[middle].value);
+        Node<Key, Value, RankInfo, Number, Policy> *root = new Node<Key, Value, RankInfo, Number, Policy>(
+                query->result[middle].key, query->result[middle].value);
         if (!this->root) {
             this->root = root;
         }
-        if (middle == 0) {
-            this->min_node = root;
+        AVL_IF_CONSTEXPR (Policy::min_max_cache) {
+            if (middle == 0) {
+                this->min_node = root;
+            }
+            if (middle == query->total - 1) {
+                this->max_node = root;
+            }
+        }
+        root->left_child = (this->TreeFromQuery(query, start, middle - 1));
+        if (root->left_child) {
+            root->left_child->SetParent(root);
+        }
+        root->right_child = this->TreeFromQuery(query, middle + 1, end);
+        if (root->right_child) {
+            root->right_child->SetParent(root);
+        }
+        root->height = (std::max(this->GetHeight(root->left_child), this->GetHeight(root->right_child)) + 1);
+        this->UpdateRank(root, root->left_child, root->right_child);
+        return root;
+    }
+
+    Node<Key, Value, RankInfo, Number, Policy> *
+    GetMostLowerCommonNode(Node<Key, Value, RankInfo, Number, Policy> *root,
+                           Node<Key, Value, RankInfo, Number, Policy> *node1,
+                           Node<Key, Value, RankInfo, Number, Policy> *node2) const {
+        Compare comparing_func;
+        while (root) {
+            COMPARE_RESULT result_1 = comparing_func(root->key, node1->key);
+            COMPARE_RESULT result_2 = comparing_func(root->key, node2->key);
+
+            if (result_1 == GREATER_THAN && result_2 == GREATER_THAN) {
+                root = root->left_child;
+            } else if (result_1 == LESS_THAN && result_2 == LESS_THAN) {
+                root = root->right_child;
+            } else {
+                return root;
+            }
+        }
+        return NULL;
+    }
+
+    /* Deallocates a subtree without recursion, rotating left children up (pointers only) as it goes. */
+    void Deallocation(Node<Key, Value, RankInfo, Number, Policy> *node) {
+        while (node) {
+            if (node->left_child) {
+                Node<Key, Value, RankInfo, Number, Policy> *left = node->left_child;
+                node->left_child = left->right_child;
+                left->right_child = node;
+                node = left;
+                continue;
+            }
+            Node<Key, Value, RankInfo, Number, Policy> *right = node->right_child;
+            this->FreeNode(node);
+            node = right;
+        }
+    }
+
+    void
+    CollectRankTraverse(Node<Key, Value, RankInfo, Number, Policy> *mlc,
+                        Node<Key, Value, RankInfo, Number, Policy> *node,
+                        Node<Key, Value, RankInfo, Number, Policy> *relative_node, RankInfo *rank,
+                        NODE_POSITION direction) const {
+        Compare comparing_func;
+        COMPARE_RESULT res;
+        for (; comparing_func(mlc->key, node->key) != EQUAL; node = node->parent) {
+            RankInfo tmp_rank = RankInfo();
+            if (direction == RIGHT_CHILD) {
+                res = comparing_func(node->key, relative_node->key); // node >= max
+                if (res == LESS_THAN) {
+                    continue;
+                }
+                this->GetRelativeRank(tmp_rank, node, RIGHT_CHILD);
+                (*rank) += tmp_rank;
+                continue;
+            }
+
+            res = comparing_func(node->key, relative_node->key); // node <= max
+            if (res == GREATER_THAN) {
+                continue;
+            }
+
+            this->GetRelativeRank(tmp_rank, node, LEFT_CHILD);
+            (*rank) += tmp_rank;
+        }
+    }
+
+    /**
+     * Accumulates the rank information of the elements within [min_key, max_key] by descending both bounds
+     * from the first node within the range (the counterpart of CollectRankTraverse without parent pointers).
+     */
+    void CollectRankRange(const Key &min_key, const Key &max_key, RankInfo *rank) const {
+        Node<Key, Value, RankInfo, Number, Policy> *node = this->root;
+        while (node) {
+            if (this->CompareKeys(node->key, min_key) == LESS_THAN) {
+                node = node->right_child;
+            } else if (this->CompareKeys(node->key, max_key) == GREATER_THAN) {
+                node = node->left_child;
+            } else {
+                break;
+            }
+        }
+        if (!node) {
+            return;
+        }
+        (*rank) += RankInfo(node->key, node->value);
+        // Left path: every node >= min_key brings its whole right subtree.
+        for (Node<Key, Value, RankInfo, Number, Policy> *left = node->left_child; left;) {
+            if (this->CompareKeys(left->key, min_key) == LESS_THAN) {
+                left = left->right_child;
+                continue;
+            }
+            (*rank) += RankInfo(left->key, left->value);
+            if (left->right_child) {
+                (*rank) += (*left->right_child->rank);
+            }
+            left = left->left_child;
+        }
+        // Right path: every node <= max_key brings its whole left subtree.
+        for (Node<Key, Value, RankInfo, Number, Policy> *right = node->right_child; right;) {
+            if (this->CompareKeys(right->key, max_key) == GREATER_THAN) {
+                right = right->left_child;
+                continue;
+            }
+            (*rank) += RankInfo(right->key, right->value);
+            if (right->left_child) {
+                (*rank) += (*right->left_child->rank);
+            }
+            right = right->right_child;
+        }
+    }
+
+    /* Accumulates the rank information of the elements between two nodes (inclusive) into rank. */
+    void CollectRankBetween(Node<Key, Value, RankInfo, Number, Policy> *min, Node<Key, Value, RankInfo, Number,
+            Policy> *max, RankInfo *rank, std::true_type) const {
+        Node<Key, Value, RankInfo, Number, Policy> *mlc = this->GetMostLowerCommonNode(this->root, min, max);
+        RankInfo tmp = RankInfo();
+        this->CollectRankTraverse(mlc, max, max, rank, LEFT_CHILD);
+        this->CollectRankTraverse(mlc, min, min, rank, RIGHT_CHILD);
+
+        this->GetRelativeRank(tmp, mlc, ROOT);
+        (*rank) += tmp;
+    }
+
+    void CollectRankBetween(Node<Key, Value, RankInfo, Number, Policy> *min, Node<Key, Value, RankInfo, Number,
+            Policy> *max, RankInfo *rank, std::false_type) const {
+        this->CollectRankRange(min->key, max->key, rank);
+    }
+
+    Number GetIndexOfKeyTraverse(Node<Key, Value, RankInfo, Number, Policy> *node, const Key &key) const {
+        Number res = 0;
+        while (node) {
+            this->PrefetchGrandchildren(node, true);
+            COMPARE_RESULT result = this->CompareKeys(key, node->key);
+            if (result == LESS_THAN) {
+                node = node->left_child;
+                continue;
+            }
+            RankInfo relative_rank = RankInfo();
+            this->GetRelativeRank(relative_rank, node);
+            res += relative_rank.rank;
+            if (result == EQUAL) {
+                break;
+            }
+            node = node->right_child;
+        }
+        return (res - 1);
+    }
+
+    Number CountTraverse(const Key &key, bool inclusive) const {
+        Node<Key, Value, RankInfo, Number, Policy> *node = this->root;
+        Number count = 0;
+        while (node) {
+            const COMPARE_RESULT result = this->CompareKeys(node->key, key);
+            if (result == LESS_THAN || (inclusive && result == EQUAL)) {
+                count += (node->left_child ? node->left_child->rank->rank : 0) + 1;
+                node = node->right_child;
+            } else {
+                node = node->left_child;
+            }
+        }
+        return count;
+    }
+
+    /* A single node, or a whole subtree prioritized by its max value (see TopKInRange). */
+    class TopCandidate {
+    public:
+        Node<Key, Value, RankInfo, Number, Policy> *node;
+        bool subtree;
+
+        TopCandidate(Node<Key, Value, RankInfo, Number, Policy> *node, bool subtree) :
+                node(node),
+                subtree(subtree) {}
+
+        const Value &Priority() const {
+            return this->subtree ? this->node->rank->max_value : this->node->value;
+        }
+
+        bool operator<(const TopCandidate &candidate) const {
+            return this->Priority() < candidate.Priority();
+        }
+    };
+
+    void PushRangeCandidates(Node<Key, Value, RankInfo, Number, Policy> *node, const Key &min_key, const Key &max_key,
+                             std::priority_queue<TopCandidate> &candidates) const {
+        while (node) {
+            if (this->compare(node->key, min_key) == LESS_THAN) {
+                node = node->right_child;
+            } else if (this->compare(node->key, max_key) == GREATER_THAN) {
+                node = node->left_child;
+            } else {
+                break;
+            }
+        }
+        if (!node) {
+            return;
+        }
+        candidates.push(TopCandidate(node, false));
+        // Left path: every node >= min_key brings its whole right subtree.
+        for (Node<Key, Value, RankInfo, Number, Policy> *left = node->left_child; left;) {
+            if (this->compare(left->key, min_key) == LESS_THAN) {
+                left = left->right_child;
+                continue;
+            }
+            candidates.push(TopCandidate(left, false));
+            if (left->right_child) {
+                candidates.push(TopCandidate(left->right_child, true));
+            }
+            left = left->left_child;
+        }
+        // Right path: every node <= max_key brings its whole left subtree.
+        for (Node<Key, Value, RankInfo, Number, Policy> *right = node->right_child; right;) {
+            if (this->compare(right->key, max_key) == GREATER_THAN) {
+                right = right->left_child;
+                continue;
+            }
+            candidates.push(TopCandidate(right, false));
+            if (right->left_child) {
+                candidates.push(TopCandidate(right->left_child, true));
+            }
+            right = right->right_child;
+        }
+    }
+
+    /* Splits the index range [begin, end) into parts of equal size, points receives parts+1 boundaries. */
+    static void PartitionRange(Number begin, Number end, Number parts, Number *points) {
+        for (Number i = 0; i <= parts; ++i) {
+            points[i] = begin + ((end - begin) * i) / parts;
+        }
+    }
+
+    /**
+     * Copies the elements of the index range [begin, end) passing the filter function into output (see ParallelQuery).
+     * @param step - 1 to write forward from output, -1 to write backwards from it.
+     * @param found - Receives the amount of written elements.
+     */
+    void QueryChunk(Number begin, Number end, KeyValuePair<Key, Value> *output, Number step,
+                    bool (*filter_function)(Key, Value), Number *found) const {
+        Number total = 0;
+        Node<Key, Value, RankInfo, Number, Policy> *node = this->FindIndexNode(begin);
+        for (Number i = begin; i < end; ++i, node = this->NextNode(node)) {
+            if (!filter_function || filter_function(node->key, node->value)) {
+                output[total * step] = KeyValuePair<Key, Value>(node->key, node->value);
+                ++total;
+            }
+        }
+        (*found) = total;
+    }
+
+    /* Actual shape of a validated subtree. */
+    class SubtreeSummary {
+    public:
+        Number height;
+        Number count;
+        Node<Key, Value, RankInfo, Number, Policy> *min;
+        Node<Key, Value, RankInfo, Number, Policy> *max;
+
+        SubtreeSummary() :
+                height(-1),
+                count(0),
+                min(NULL),
+                max(NULL) {}
+    };
+
+    /* Shared state of the validation workers (see Validate). */
+    class ValidationState {
+    public:
+        std::vector<Node<Key, Value, RankInfo, Number, Policy> *> frontier;
+        std::vector<SubtreeSummary> summaries;
+        std::vector<ValidationReport<Key, Value, RankInfo, Number, Policy> > reports;
+        std::atomic<size_t> next;
+        std::atomic<size_t> visited;
+        std::atomic<bool> aborted;
+        size_t max_issues;
+        bool check_balance;
+        /* Ancestors of the deferred rank updates (sorted), their rank information may be stale. */
+        std::vector<Node<Key, Value, RankInfo, Number, Policy> *> stale;
+
+        ValidationState() :
+                frontier(),
+                summaries(),
+                reports(),
+                next(0),
+                visited(0),
+                aborted(false),
+                max_issues(0),
+                check_balance(true),
+                stale() {}
+    };
+
+    template<typename R>
+    static auto RankEquals(const R &rank1, const R &rank2, int) -> decltype(bool(rank1 == rank2)) {
+        return rank1 == rank2;
+    }
+
+    /* Rank information without an equality operator is only checked by its count. */
+    template<typename R>
+    static bool RankEquals(const R &, const R &, long) {
+        return true;
+    }
+
+    static void ReportIssue(ValidationReport<Key, Value, RankInfo, Number, Policy> &report, size_t max_issues,
+                            VALIDATION_ERROR error, const Node<Key, Value, RankInfo, Number, Policy> *node) {
+        ++report.total_issues;
+        if (report.issues.size() < max_issues) {
+            report.issues.push_back(
+                    typename ValidationReport<Key, Value, RankInfo, Number, Policy>::Issue(error, node));
+        }
+    }
+
+    /* Checks the invariants of a node given the actual shape of its subtrees. */
+    SubtreeSummary ValidateNode(Node<Key, Value, RankInfo, Number, Policy> *node, const SubtreeSummary &left,
+                                const SubtreeSummary &right,
+                                ValidationReport<Key, Value, RankInfo, Number, Policy> &report,
+                                const ValidationState &state) const {
+        const size_t max_issues = state.max_issues;
+        ++report.checked;
+        if (Policy::parent_pointers && ((node->left_child && node->left_child->GetParent() != node) ||
+                                        (node->right_child && node->right_child->GetParent() != node))) {
+            ReportIssue(report, max_issues, PARENT_MISMATCH, node);
+        }
+        if ((left.max && this->compare(left.max->key, node->key) == GREATER_THAN) ||
+            (right.min && this->compare(right.min->key, node->key) == LESS_THAN)) {
+            ReportIssue(report, max_issues, ORDER_VIOLATION, node);
+        }
+        SubtreeSummary summary;
+        summary.height = std::max(left.height, right.height) + 1;
+        summary.count = left.count + right.count + 1;
+        summary.min = left.min ? left.min : node;
+        summary.max = right.max ? right.max : node;
+        if (node->height != summary.height) {
+            ReportIssue(report, max_issues, HEIGHT_MISMATCH, node);
+        }
+        if (state.check_balance && (left.height - right.height > 1 || right.height - left.height > 1)) {
+            ReportIssue(report, max_issues, BALANCE_VIOLATION, node);
+        }
+        if (!std::binary_search(state.stale.begin(), state.stale.end(), node) &&
+            !this->RankMatches(node, summary.count, RankTag())) {
+            ReportIssue(report, max_issues, RANK_MISMATCH, node);
+        }
+        return summary;
+    }
+
+    /* Checks the rank information of a node against its children and its actual subtree size. */
+    bool RankMatches(const Node<Key, Value, RankInfo, Number, Policy> *node, Number count, std::true_type) const {
+        RankInfo expected = RankInfo(node->key, node->value);
+        if (node->left_child) {
+            expected += (*node->left_child->rank);
+        }
+        if (node->right_child) {
+            expected += (*node->right_child->rank);
+        }
+        return node->rank->rank == count && RankEquals(expected, *node->rank, 0);
+    }
+
+    bool RankMatches(const Node<Key, Value, RankInfo, Number, Policy> *, Number, std::false_type) const {
+        return true;
+    }
+
+    /* Iterative post-order validation of a subtree, stopping if more nodes are reachable than the tree size. */
+    SubtreeSummary ValidateSubtree(Node<Key, Value, RankInfo, Number, Policy> *root, ValidationState &state,
+                                   ValidationReport<Key, Value, RankInfo, Number, Policy> &report) const {
+        class Frame {
+        public:
+            Node<Key, Value, RankInfo, Number, Policy> *node;
+            int stage;
+            SubtreeSummary left;
+        };
+        std::vector<Frame> stack;
+        SubtreeSummary result;
+        Frame frame;
+        frame.node = root;
+        frame.stage = 0;
+        stack.push_back(frame);
+        while (!stack.empty()) {
+            const size_t top = stack.size() - 1;
+            Node<Key, Value, RankInfo, Number, Policy> *node = stack[top].node;
+            if (!node) {
+                result = SubtreeSummary();
+                stack.pop_back();
+                continue;
+            }
+            if (stack[top].stage == 0) {
+                if (state.aborted || ++state.visited > (size_t) this->size) {
+                    state.aborted = true;
+                    return SubtreeSummary();
+                }
+                stack[top].stage = 1;
+                frame.node = node->left_child;
+            } else if (stack[top].stage == 1) {
+                stack[top].left = result;
+                stack[top].stage = 2;
+                frame.node = node->right_child;
+            } else {
+                result = this->ValidateNode(node, stack[top].left, result, report, state);
+                stack.pop_back();
+                continue;
+            }
+            stack.push_back(frame);
+        }
+        return result;
+    }
+
+    void ValidateWorker(ValidationState *state) const {
+        for (size_t task = state->next++; task < state->frontier.size(); task = state->next++) {
+            state->summaries[task] = this->ValidateSubtree(state->frontier[task], *state, state->reports[task]);
+        }
+    }
+
+    /* Collects the nodes whose rank information may be stale in approximate rank mode (see SetRankErrorBound). */
+    void CollectStaleRanks(std::vector<Node<Key, Value, RankInfo, Number, Policy> *> &stale) const {
+        for (size_t i = 0; i < this->pending_ranks.size(); ++i) {
+            // Bounded by the height, a corrupted parent chain is reported by the validation itself.
+            int depth = 0;
+            for (Node<Key, Value, RankInfo, Number, Policy> *node = this->pending_ranks[i];
+                 node && depth < MAX_PATH; node = node->GetParent(), ++depth) {
+                stale.push_back(node);
+            }
+        }
+        std::sort(stale.begin(), stale.end());
+        stale.erase(std::unique(stale.begin(), stale.end()), stale.end());
+    }
+
+    void CollectFrontier(Node<Key, Value, RankInfo, Number, Policy> *node, Number depth,
+                         std::vector<Node<Key, Value, RankInfo, Number, Policy> *> &frontier) const {
+        if (!node) {
+            return;
+        }
+        if (depth == 0) {
+            frontier.push_back(node);
+            return;
+        }
+        this->CollectFrontier(node->left_child, depth - 1, frontier);
+        this->CollectFrontier(node->right_child, depth - 1, frontier);
+    }
+
+    /* Validates the levels above the frontier from the summaries of the frontier subtrees (in order). */
+    SubtreeSummary ValidateTop(Node<Key, Value, RankInfo, Number, Policy> *node, Number depth, ValidationState &state,
+                               size_t &next, ValidationReport<Key, Value, RankInfo, Number, Policy> &report) const {
+        if (!node) {
+            return SubtreeSummary();
+        }
+        if (depth == 0) {
+            return state.summaries[next++];
+        }
+        const SubtreeSummary left = this->ValidateTop(node->left_child, depth - 1, state, next, report);
+        const SubtreeSummary right = this->ValidateTop(node->right_child, depth - 1, state, next, report);
+        return this->ValidateNode(node, left, right, report, state);
+    }
+
+    /* Index of the range (sorted, disjoint) within [begin, end) holding a key, or end if none. */
+    Number FindRange(const std::pair<Key, Key> *ranges, Number begin, Number end, const Key &key) const {
+        Number low = begin;
+        Number high = end;
+        while (low < high) {
+            const Number middle = low + (high - low) / 2;
+            if (this->compare(ranges[middle].first, key) == GREATER_THAN) {
+                high = middle;
+            } else {
+                low = middle + 1;
+            }
+        }
+        if (low == begin || this->compare(key, ranges[low - 1].second) == GREATER_THAN) {
+            return end;
+        }
+        return low - 1;
+    }
+
+    /* Narrows [begin, end) to the ranges intersecting [low->key, high->key], the key bounds of a subtree. */
+    void NarrowRanges(const std::pair<Key, Key> *ranges, Number &begin, Number &end,
+                      const Node<Key, Value, RankInfo, Number, Policy> *low,
+                      const Node<Key, Value, RankInfo, Number, Policy> *high) const {
+        while (begin < end && this->compare(ranges[begin].second, low->key) == LESS_THAN) {
+            ++begin;
+        }
+        while (begin < end && this->compare(ranges[end - 1].first, high->key) == GREATER_THAN) {
+            --end;
+        }
+    }
+
+    /* Pending subtree of a multi-range traversal (or its root alone, once its left subtree is done). */
+    class RangeFrame {
+    public:
+        Node<Key, Value, RankInfo, Number, Policy> *node;
+        Number begin;
+        Number end;
+        const Node<Key, Value, RankInfo, Number, Policy> *low;
+        const Node<Key, Value, RankInfo, Number, Policy> *high;
+        bool visit;
+
+        RangeFrame(Node<Key, Value, RankInfo, Number, Policy> *node, Number begin, Number end,
+                   const Node<Key, Value, RankInfo, Number, Policy> *low,
+                   const Node<Key, Value, RankInfo, Number, Policy> *high,
+                   bool visit) :
+                node(node),
+                begin(begin),
+                end(end),
+                low(low),
+                high(high),
+                visit(visit) {}
+    };
+
+    /* Index of the first range (sorted, disjoint) within [begin, end) starting above a key. */
+    Number FirstRangeAbove(const std::pair<Key, Key> *ranges, Number begin, Number end, const Key &key) const {
+        while (begin < end) {
+            const Number middle = begin + (end - begin) / 2;
+            if (this->compare(ranges[middle].first, key) == GREATER_THAN) {
+                end = middle;
+            } else {
+                begin = middle + 1;
+            }
+        }
+        return begin;
+    }
+
+    /* Accumulates the rank information of the elements of a subtree within a single range. */
+    void CollectRangeInSubtree(Node<Key, Value, RankInfo, Number, Policy> *node, const std::pair<Key, Key> &range,
+                               RankInfo &result) const {
+        // Descends to the first node within the range, where the paths to both bounds split.
+        while (node) {
+            if (this->compare(node->key, range.first) == LESS_THAN) {
+                node = node->right_child;
+            } else if (this->compare(node->key, range.second) == GREATER_THAN) {
+                node = node->left_child;
+            } else {
+                break;
+            }
+        }
+        if (!node) {
+            return;
+        }
+        result += RankInfo(node->key, node->value);
+        // Lower bound path: every node within the range brings its right subtree along.
+        for (Node<Key, Value, RankInfo, Number, Policy> *current = node->left_child; current;) {
+            if (this->compare(current->key, range.first) == LESS_THAN) {
+                current = current->right_child;
+                continue;
+            }
+            result += RankInfo(current->key, current->value);
+            if (current->right_child) {
+                result += (*current->right_child->rank);
+            }
+            current = current->left_child;
+        }
+        // Upper bound path: every node within the range brings its left subtree along.
+        for (Node<Key, Value, RankInfo, Number, Policy> *current = node->right_child; current;) {
+            if (this->compare(current->key, range.second) == GREATER_THAN) {
+                current = current->left_child;
+                continue;
+            }
+            result += RankInfo(current->key, current->value);
+            if (current->left_child) {
+                result += (*current->left_child->rank);
+            }
+            current = current->right_child;
+        }
+    }
+
+    /**
+     * Accumulates the rank information of every range within a subtree (see CollectRankBatch).
+     * Subtrees meeting several ranges are split at their root, and a subtree meeting a single range is collected
+     * along the two paths to its bounds, so every node is compared against the ranges once.
+     * @param low - Node holding the lower key bound of the subtree.
+     * @param high - Node holding the upper key bound of the subtree.
+     */
+    void CollectRankBatchTraverse(Node<Key, Value, RankInfo, Number, Policy> *node, const std::pair<Key, Key> *ranges,
+                                  Number begin, Number end, RankInfo *results,
+                                  const Node<Key, Value, RankInfo, Number, Policy> *low,
+                                  const Node<Key, Value, RankInfo, Number, Policy> *high) const {
+        // Explicit stack, so deep trees do not exhaust the call stack.
+        std::vector<RangeFrame> stack;
+        stack.push_back(RangeFrame(node, begin, end, low, high, false));
+        while (!stack.empty()) {
+            RangeFrame frame = stack.back();
+            stack.pop_back();
+            node = frame.node;
+            if (!node || frame.begin == frame.end) {
+                continue;
+            }
+            if (frame.end - frame.begin == 1) {
+                const std::pair<Key, Key> &range = ranges[frame.begin];
+                if (this->compare(range.first, frame.low->key) != GREATER_THAN &&
+                    this->compare(range.second, frame.high->key) != LESS_THAN) {
+                    // The whole subtree lies within the range.
+                    results[frame.begin] += (*node->rank);
+                } else {
+                    this->CollectRangeInSubtree(node, range, results[frame.begin]);
+                }
+                continue;
+            }
+            // Ranges starting up to the node key go left, ranges ending above it go right.
+            const Number above = this->FirstRangeAbove(ranges, frame.begin, frame.end, node->key);
+            Number right_begin = above;
+            if (above > frame.begin && this->compare(node->key, ranges[above - 1].second) != GREATER_THAN) {
+                results[above - 1] += RankInfo(node->key, node->value);
+                right_begin = above - 1;
+            }
+            stack.push_back(RangeFrame(node->right_child, right_begin, frame.end, node, frame.high, false));
+            stack.push_back(RangeFrame(node->left_child, frame.begin, above, frame.low, node, false));
+        }
+    }
+
+    template<typename Function>
+    void QueryMultiRangeTraverse(Node<Key, Value, RankInfo, Number, Policy> *node, const std::pair<Key, Key> *ranges,
+                                 Number begin, Number end, Function &visitor,
+                                 const Node<Key, Value, RankInfo, Number, Policy> *low,
+                                 const Node<Key, Value, RankInfo, Number, Policy> *high) const {
+        // Explicit stack of the in-order walk, so deep trees do not exhaust the call stack.
+        std::vector<RangeFrame> stack;
+        stack.push_back(RangeFrame(node, begin, end, low, high, false));
+        while (!stack.empty()) {
+            RangeFrame frame = stack.back();
+            stack.pop_back();
+            node = frame.node;
+            if (frame.visit) {
+                const Number range = this->FindRange(ranges, frame.begin, frame.end, node->key);
+                if (range != frame.end) {
+                    visitor(range, node->key, node->value);
+                }
+                continue;
+            }
+            if (!node) {
+                continue;
+            }
+            this->NarrowRanges(ranges, frame.begin, frame.end, frame.low, frame.high);
+            if (frame.begin == frame.end) {
+                continue;
+            }
+            stack.push_back(RangeFrame(node->right_child, frame.begin, frame.end, node, frame.high, false));
+            stack.push_back(RangeFrame(node, frame.begin, frame.end, frame.low, frame.high, true));
+            stack.push_back(RangeFrame(node->left_child, frame.begin, frame.end, frame.low, node, false));
+        }
+    }
+
+    /**
+     * Validates the tree (see Validate).
+     * @param check_balance - Whether the AVL balance of every node is checked (trees that do not keep it skip it).
+     */
+    ValidationReport<Key, Value, RankInfo, Number, Policy>
+    ValidateTree(unsigned threads, size_t max_issues, bool check_balance) const {
+        ValidationReport<Key, Value, RankInfo, Number, Policy> report =
+                ValidationReport<Key, Value, RankInfo, Number, Policy>();
+        threads = std::max(threads, 1u);
+        Number depth = 0;
+        while (threads > 1 && ((Number) 1 << depth) < (Number) threads * 4 && depth < 20) {
+            ++depth;
+        }
+        ValidationState state;
+        state.max_issues = max_issues;
+        state.check_balance = check_balance;
+        this->CollectStaleRanks(state.stale);
+        this->CollectFrontier(this->root, depth, state.frontier);
+        state.summaries.resize(state.frontier.size());
+        state.reports.resize(state.frontier.size());
+        std::vector<std::thread> workers;
+        for (unsigned i = 1; i < threads && i < state.frontier.size(); ++i) {
+            workers.push_back(std::thread(&AVLRankTree::ValidateWorker, this, &state));
+        }
+        this->ValidateWorker(&state);
+        for (size_t i = 0; i < workers.size(); ++i) {
+            workers[i].join();
+        }
+        for (size_t i = 0; i < state.reports.size(); ++i) {
+            report.checked += state.reports[i].checked;
+            report.total_issues += state.reports[i].total_issues;
+            for (size_t j = 0; j < state.reports[i].issues.size() && report.issues.size() < max_issues; ++j) {
+                report.issues.push_back(state.reports[i].issues[j]);
+            }
+        }
+        if (state.aborted) {
+            // A cycle or more nodes than the size: the shape above the frontier cannot be trusted.
+            report.complete = false;
+            ReportIssue(report, max_issues, SIZE_MISMATCH, NULL);
+            return report;
         }
-        if (middle == query->total - 1) {
-            this->max_node = root;
+        size_t next = 0;
+        const SubtreeSummary summary = this->ValidateTop(this->root, depth, state, next, report);
+        if (this->root && this->root->GetParent()) {
+            ReportIssue(report, max_issues, PARENT_MISMATCH, this->root);
         }
-        root->left_child = (this->TreeFromQuery(query, start, middle - 1));
-        if (root->left_child) {
-            root->left_child->parent = root;
+        if (summary.count != this->size) {
+            ReportIssue(report, max_issues, SIZE_MISMATCH, NULL);
         }
-        root->right_child = this->TreeFromQuery(query, middle + 1, end);
-        if (root->right_child) {
-            root->right_child->parent = root;
+        if (Policy::min_max_cache && summary.min != this->min_node) {
+            ReportIssue(report, max_issues, MIN_NODE_MISMATCH, NULL);
         }
-        root->height = (std::max(this->GetHeight(root->left_child), this->GetHeight(root->right_child)) + 1);
-        this->UpdateRank(root, root->left_child, root->right_child);
-        return root;
+        if (Policy::min_max_cache && summary.max != this->max_node) {
+            ReportIssue(report, max_issues, MAX_NODE_MISMATCH, NULL);
+        }
+        return report;
     }
 
-    Node<Key, Value, RankInfo, Number> *
-    GetMostLowerCommonNode(Node<Key, Value, RankInfo, Number> *root, Node<Key, Value, RankInfo, Number> *node1,
-                           Node<Key, Value, RankInfo, Number> *node2) const {
-        if (root == NULL) {
-            return NULL;
+    bool InsertOrAssignTraverse(const Key &key, const Value &value, std::true_type) {
+        Node<Key, Value, RankInfo, Number, Policy> *parent = NULL;
+        Node<Key, Value, RankInfo, Number, Policy> *current = this->root;
+        COMPARE_RESULT result = EQUAL;
+        while (current) {
+            result = this->CompareKeys(key, current->key);
+            if (result == EQUAL) {
+                current->value = value;
+                this->UpdateRankUpwards(current);
+                return false;
+            }
+            parent = current;
+            current = (result == LESS_THAN ? current->left_child : current->right_child);
         }
+        this->LinkNode(this->AllocateNode(key, value), parent, result);
+        return true;
+    }
 
-        Compare comparing_func;
-        COMPARE_RESULT result_1 = comparing_func(root->key, node1->key);
-        COMPARE_RESULT result_2 = comparing_func(root->key, node2->key);
-
-        if (result_1 == GREATER_THAN && result_2 == GREATER_THAN) {
-            return this->GetMostLowerCommonNode(root->left_child, node1, node2);
+    bool InsertOrAssignTraverse(const Key &key, const Value &value, std::false_type) {
+        Node<Key, Value, RankInfo, Number, Policy> *path[MAX_PATH];
+        int depth = 0;
+        COMPARE_RESULT result = EQUAL;
+        for (Node<Key, Value, RankInfo, Number, Policy> *current = this->root; current;) {
+            path[depth++] = current;
+            result = this->CompareKeys(key, current->key);
+            if (result == EQUAL) {
+                current->value = value;
+                this->UpdateRankPath(path, depth);
+                return false;
+            }
+            current = (result == LESS_THAN ? current->left_child : current->right_child);
         }
+        this->LinkPath(this->AllocateNode(key, value), path, depth, result);
+        return true;
+    }
 
-        if (result_1 == LESS_THAN && result_2 == LESS_THAN) {
-            return this->GetMostLowerCommonNode(root->right_child, node1, node2);
+    template<typename Function>
+    bool UpdateTraverse(const Key &key, Function &function, std::true_type) {
+        Node<Key, Value, RankInfo, Number, Policy> *node = this->FindTraverse(this->root, key);
+        if (!node) {
+            return false;
         }
-
-        return root;
+        function(node->value);
+        this->UpdateRankUpwards(node);
+        return true;
     }
 
-    void Deallocation(Node<Key, Value, RankInfo, Number> *node) {
+    template<typename Function>
+    bool UpdateTraverse(const Key &key, Function &function, std::false_type) {
+        Node<Key, Value, RankInfo, Number, Policy> *path[MAX_PATH];
+        int depth = 0;
+        Node<Key, Value, RankInfo, Number, Policy> *node = this->FindPath(key, path, depth);
         if (!node) {
-            return;
+            return false;
         }
-        this->Deallocation(node->left_child);
-        this->Deallocation(node->right_child);
-        delete node;
+        function(node->value);
+        this->UpdateRankPath(path, depth);
+        return true;
     }
 
-    void
-    CollectRankTraverse(Node<Key, Value, RankInfo, Number> *mlc, Node<Key, Value, RankInfo, Number> *node,
-                        Node<Key, Value, RankInfo, Number> *relative_node, RankInfo *rank,
-                        NODE_POSITION direction) const {
-        RankInfo tmp_rank = RankInfo();
-        Compare comparing_func;
-        COMPARE_RESULT res;
-        if (comparing_func(mlc->key, node->key) == EQUAL) {
-            return;
-        }
-        if (direction == RIGHT_CHILD) {
-            res = comparing_func(node->key, relative_node->key); // node >= max
-            if (res == LESS_THAN) {
-                this->CollectRankTraverse(mlc, node->parent, relative_node, rank, direction);
-                return;
-            }
-            this->GetRelativeRank(tmp_rank, node, RIGHT_CHILD);
-            (*rank) += tmp_rank;
-            this->CollectRankTraverse(mlc, node->parent, relative_node, rank, direction);
-            return;
+    bool ChangeKeyTraverse(const Key &old_key, const Key &new_key, std::true_type) {
+        Node<Key, Value, RankInfo, Number, Policy> *node = this->FindTraverse(this->root, old_key);
+        if (!node) {
+            return false;
         }
+        this->ChangeNodeKey(node, new_key);
+        return true;
+    }
 
-        res = comparing_func(node->key, relative_node->key); // node <= max
-        if (res == GREATER_THAN) {
-            this->CollectRankTraverse(mlc, node->parent, relative_node, rank, direction);
-            return;
+    bool ChangeKeyTraverse(const Key &old_key, const Key &new_key, std::false_type) {
+        Node<Key, Value, RankInfo, Number, Policy> *path[MAX_PATH];
+        int depth = 0;
+        Node<Key, Value, RankInfo, Number, Policy> *node = this->FindPath(old_key, path, depth);
+        if (!node) {
+            return false;
         }
-
-        this->GetRelativeRank(tmp_rank, node, LEFT_CHILD);
-        (*rank) += tmp_rank;
-        this->CollectRankTraverse(mlc, node->parent, relative_node, rank, direction);
+        this->DetachPath(path, depth);
+        node->key = new_key;
+        this->AttachNode(node, std::false_type());
+        return true;
     }
 
-    Number GetIndexOfKeyTraverse(Node<Key, Value, RankInfo> *node, const Key &key) const {
+    bool RemoveTraverse(const Key &key, std::true_type) {
+        Node<Key, Value, RankInfo, Number, Policy> *node = this->FindTraverse(this->root, key);
         if (!node) {
-            return -1;
-        }
-        Compare comparing_func;
-        COMPARE_RESULT result = comparing_func(key, node->key);
-        RankInfo relative_rank = RankInfo();
-        Number res = 0;
-        if (result == EQUAL) {
-            this->GetRelativeRank(relative_rank, node);
-            res = relative_rank.rank;
-            return (res - 1);
-        }
-        if (result == LESS_THAN) {
-            return (this->GetIndexOfKeyTraverse(node->left_child, key));
+            return false;
         }
-        this->GetRelativeRank(relative_rank, node);
-        res = relative_rank.rank;
-        return (res + this->GetIndexOfKeyTraverse(node->right_child, key));
+        this->RemoveNode(node);
+        return true;
     }
 
-    std::ostream &PrintTreeInOrder(std::ostream &os, Node<Key, Value, RankInfo, Number> *node) const {
+    bool RemoveTraverse(const Key &key, std::false_type) {
+        Node<Key, Value, RankInfo, Number, Policy> *path[MAX_PATH];
+        int depth = 0;
+        Node<Key, Value, RankInfo, Number, Policy> *node = this->FindPath(key, path, depth);
         if (!node) {
-            return os;
+            return false;
+        }
+        this->DetachPath(path, depth);
+        this->FreeNode(node);
+        return true;
+    }
+
+    std::ostream &PrintTreeInOrder(std::ostream &os, Node<Key, Value, RankInfo, Number, Policy> *node) const {
+        std::vector<Node<Key, Value, RankInfo, Number, Policy> *> order;
+        this->CollectInOrder(node, order);
+        for (size_t i = 0; i < order.size(); ++i) {
+            order[i]->Print(os);
         }
-        this->PrintTreeInOrder(os, node->left_child);
-        node->Print(os);
-        this->PrintTreeInOrder(os, node->right_child);
         return os;
     }
 
@@ -795,7 +2599,18 @@ public:
             root(NULL),
             max_node(NULL),
             min_node(NULL),
-            compare() {}
+            compare(),
+            rank_error_bound(0),
+            pending_updates(0),
+            pending_ranks(),
+            pending_count(0),
+            flush_levels(),
+            arena(NULL),
+            arena_capacity(0),
+            arena_free(NULL),
+            arena_request(DEFAULT_PAGES),
+            arena_pages(DEFAULT_PAGES),
+            arena_bytes(0) {}
 
     /**
      * Copy Constructor: Creates a copy from an existing AVL rank tree.
@@ -807,7 +2622,18 @@ public:
             root(NULL),
             max_node(NULL),
             min_node(NULL),
-            compare() {
+            compare(),
+            rank_error_bound(0),
+            pending_updates(0),
+            pending_ranks(),
+            pending_count(0),
+            flush_levels(),
+            arena(NULL),
+            arena_capacity(0),
+            arena_free(NULL),
+            arena_request(DEFAULT_PAGES),
+            arena_pages(DEFAULT_PAGES),
+            arena_bytes(0) {
         if (!tree.root) {
             return;
         }
@@ -823,14 +2649,25 @@ public:
      * @param first_tree - AVL rank tree as a reference.
      * @param second_tree - AVL rank tree as a reference.
      */
-    AVLRankTree(const AVL::AVLRankTree<Key, Value, Number, RankInfo, Compare> &first_tree,
-                const AVL::AVLRankTree<Key, Value, Number, RankInfo, Compare> &second_tree)
+    AVLRankTree(const AVL::AVLRankTree<Key, Value, Number, RankInfo, Compare, Policy> &first_tree,
+                const AVL::AVLRankTree<Key, Value, Number, RankInfo, Compare, Policy> &second_tree)
             :
             size(first_tree.size + second_tree.size),
             root(NULL),
             max_node(NULL),
             min_node(NULL),
-            compare() {
+            compare(),
+            rank_error_bound(0),
+            pending_updates(0),
+            pending_ranks(),
+            pending_count(0),
+            flush_levels(),
+            arena(NULL),
+            arena_capacity(0),
+            arena_free(NULL),
+            arena_request(DEFAULT_PAGES),
+            arena_pages(DEFAULT_PAGES),
+            arena_bytes(0) {
         if (this->size == 0) {
             return;
         }
@@ -848,6 +2685,9 @@ public:
      */
     ~AVLRankTree() {
         this->Deallocation(this->root);
+        if (this->arena) {
+            FreeArena(this->arena, this->arena_bytes);
+        }
     }
 
     /**
@@ -875,35 +2715,182 @@ public:
      * @return {Number} Index of an element as if it was in a sorted array.
      */
     Number GetIndexOfKey(const Key &key) const {
+        static_assert(Policy::rank_augmentation, "GetIndexOfKey requires the rank augmentation policy.");
         return this->GetIndexOfKeyTraverse(this->root, key);
     }
 
     /**
-     * Gets the Max element by key.
+     * Counts the elements whose key is less than a given key (supports duplicate keys).
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param key - The bounding key.
+     * @return {Number} Amount of elements with a key less than the given key.
+     */
+    Number CountLessThan(const Key &key) const {
+        static_assert(Policy::rank_augmentation, "CountLessThan requires the rank augmentation policy.");
+        return this->CountTraverse(key, false);
+    }
+
+    /**
+     * Counts the elements whose key is less than or equal to a given key (supports duplicate keys).
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param key - The bounding key.
+     * @return {Number} Amount of elements with a key less than or equal to the given key.
+     */
+    Number CountLessOrEqual(const Key &key) const {
+        static_assert(Policy::rank_augmentation, "CountLessOrEqual requires the rank augmentation policy.");
+        return this->CountTraverse(key, true);
+    }
+
+    /**
+     * Sets the approximate rank mode error bound.
+     * Insertions and removals stop updating the rank information of the ancestors once the rebalancing is
+     * done and defer it, until more than bound updates are pending. GetIndexOfKey, CountLessThan,
+     * CountLessOrEqual, GetIndexOfNode, CollectRank, FindIndex and FindIndexNode may then be off by up to
+     * bound. Const lookups never flush (they stay safe for concurrent readers), call FlushRanks for exact ranks.
+     * @note Worst-Time Complexity: O(pending*log(n)) when the pending updates exceed the new bound.
+     * @note Intended for counting rank information, aggregates such as max values may be stale as well.
+     * @param bound - Maximum amount of deferred updates, 0 for exact mode (Default).
+     */
+    void SetRankErrorBound(Number bound) {
+        static_assert(Policy::parent_pointers && Policy::rank_augmentation,
+                      "SetRankErrorBound requires the parent pointers and rank augmentation policies.");
+        this->rank_error_bound = bound;
+        if (this->pending_updates > bound) {
+            this->FlushRanks();
+        }
+    }
+
+    /**
+     * Gets the approximate rank mode error bound.
+     * @note Worst-Time Complexity: O(1).
+     * @return {Number} Maximum amount of deferred updates, 0 in exact mode.
+     */
+    Number GetRankErrorBound() const {
+        return this->rank_error_bound;
+    }
+
+    /**
+     * Applies every deferred rank information update (approximate rank mode).
+     * @note Worst-Time Complexity: O(pending*log(n)), shared ancestors are updated once.
+     */
+    void FlushRanks() {
+        this->pending_updates = 0;
+        if (this->pending_count == 0) {
+            return;
+        }
+        // Updates bottom-up by height (an ancestor is higher), so each stale ancestor is recomputed once after its
+        // children. Heights are exact, only the rank information is deferred.
+        std::vector<std::vector<Node<Key, Value, RankInfo, Number, Policy> *> > &levels = this->flush_levels;
+        if (levels.size() <= (size_t) this->root->height) {
+            levels.resize(this->root->height + 1);
+        }
+        for (size_t i = 0; i < this->pending_ranks.size(); ++i) {
+            if (this->pending_ranks[i]) {
+                levels[this->pending_ranks[i]->height].push_back(this->pending_ranks[i]);
+                this->pending_ranks[i] = NULL;
+            }
+        }
+        this->pending_count = 0;
+        for (size_t height = 0; height < levels.size(); ++height) {
+            std::vector<Node<Key, Value, RankInfo, Number, Policy> *> &level = levels[height];
+            std::sort(level.begin(), level.end());
+            level.erase(std::unique(level.begin(), level.end()), level.end());
+            for (size_t i = 0; i < level.size(); ++i) {
+                this->UpdateRank(level[i], level[i]->left_child, level[i]->right_child);
+                if (level[i]->GetParent()) {
+                    levels[level[i]->GetParent()->height].push_back(level[i]->GetParent());
+                }
+            }
+            level.clear();
+        }
+    }
+
+    /**
+     * Rewrites every node into a single contiguous arena in van Emde Boas order, so descents and range scans
+     * touch far fewer cache lines and pages than nodes scattered by a long history of insertions and removals.
+     * Slots of nodes removed later are recycled by the following insertions, spare reserved slots are kept.
+     * @note Worst-Time Complexity: O(n*log(log(n))).
+     * @note Worst-Space Complexity: O(n).
+     * @note Invalidates every node handle (nodes move to new addresses).
+     * @param rebuild - Also rebuild the tree to perfect balance (Default: false).
+     */
+    void Compact(bool rebuild = false) {
+        this->Relayout(std::max(this->size, this->arena_capacity), rebuild);
+    }
+
+    /**
+     * Reserves arena slots for future insertions (relayouts the existing nodes like Compact).
+     * @note Worst-Time Complexity: O(n*log(log(n))) if the capacity grows, o.w O(1).
+     * @note Invalidates every node handle if the capacity grows.
+     * @param capacity - Amount of elements the arena should hold.
+     */
+    void Reserve(Number capacity) {
+        if (capacity > this->arena_capacity && capacity >= this->size) {
+            this->Relayout(capacity, false);
+        }
+    }
+
+    /**
+     * Sets the pages backing the next arena (allocated by Compact or Reserve).
+     * Transparent huge pages map the arena 2MB aligned and advise the kernel (madvise(MADV_HUGEPAGE)),
+     * explicit huge pages use MAP_HUGETLB and need reserved huge pages (vm.nr_hugepages).
+     * Unavailable modes fall back gracefully, explicit to transparent and transparent to default pages.
+     * @note Worst-Time Complexity: O(1).
+     * @note Linux only, other platforms always use default pages.
+     * @param pages - DEFAULT_PAGES (Default), TRANSPARENT_HUGE_PAGES or EXPLICIT_HUGE_PAGES.
+     */
+    void SetArenaPages(ARENA_PAGES pages) {
+        this->arena_request = pages;
+    }
+
+    /**
+     * Gets the pages actually backing the current arena.
      * @note Worst-Time Complexity: O(1).
+     * @return {ARENA_PAGES} The pages obtained after any fallback.
+     */
+    ARENA_PAGES GetArenaPages() const {
+        return this->arena_pages;
+    }
+
+    /**
+     * Gets the Max element by key.
+     * @note Worst-Time Complexity: O(1), O(log(n)) without the min/max cache policy.
      * @return {KeyValuePair<Key, Value>} The maximum element or NULL if the tree is empty.
      */
     KeyValuePair<Key, Value> *GetMax() const {
-        if (!this->max_node) {
+        Node<Key, Value, RankInfo, Number, Policy> *max = this->MaxNode();
+        if (!max) {
             return NULL;
         }
-        KeyValuePair<Key, Value> *result = new KeyValuePair<Key, Value>(this->max_node->key, this->max_node->value);
+        KeyValuePair<Key, Value> *result = new KeyValuePair<Key, Value>(max->key, max->value);
         return result;
     }
 
     /**
      * Gets the Min element by key.
-     * @note Worst-Time Complexity: O(1).
+     * @note Worst-Time Complexity: O(1), O(log(n)) without the min/max cache policy.
      * @return {KeyValuePair<Key, Value>} The minimum element or NULL if the tree is empty.
      */
     KeyValuePair<Key, Value> *GetMin() const {
-        if (!this->min_node) {
+        Node<Key, Value, RankInfo, Number, Policy> *min = this->MinNode();
+        if (!min) {
             return NULL;
         }
-        KeyValuePair<Key, Value> *result = new KeyValuePair<Key, Value>(this->min_node->key, this->min_node->value);
+        KeyValuePair<Key, Value> *result = new KeyValuePair<Key, Value>(min->key, min->value);
         return result;
     }
 
+    /**
+     * Gets the operation counters (comparisons, rotations, inserts and removes).
+     * @note Worst-Time Complexity: O(1).
+     * @note Requires the operation stats policy.
+     * @return {PolicyTreeStats<Number>} The counters since the construction of the tree.
+     */
+    const AVL::PolicyTreeStats<Number> &GetStats() const {
+        static_assert(Policy::operation_stats, "GetStats requires the operation stats policy.");
+        return this->stats;
+    }
+
     /**
      * Find an element by its key.
      * @note Worst-Time Complexity: O(log(n)).
@@ -911,7 +2898,7 @@ public:
      * @return {KeyValuePair<Key, Value>} element or NULL if not found.
      */
     KeyValuePair<Key, Value> *Find(const Key key) const {
-        Node<Key, Value, RankInfo, Number> *result_node = this->FindTraverse(this->root, key);
+        Node<Key, Value, RankInfo, Number, Policy> *result_node = this->FindTraverse(this->root, key);
         if (!result_node) {
             return NULL;
         }
@@ -926,14 +2913,11 @@ public:
      * @return {KeyValuePair<Key, Value>} element or NULL if not found.
      */
     KeyValuePair<Key, Value> *FindIndex(const Number &index) const {
+        static_assert(Policy::rank_augmentation, "FindIndex requires the rank augmentation policy.");
         if (index < 0 || index >= this->size) {
             throw std::out_of_range("Index out of range.");
         }
-        RankInfo rank = RankInfo();
-        this->GetRelativeRank(rank, this->root);
-        Number res_index = rank.rank;
-        Node<Key, Value, RankInfo, Number> *result_node =
-                this->FindIndexTraverse(this->root, (index + 1), res_index);
+        Node<Key, Value, RankInfo, Number, Policy> *result_node = this->FindIndexTraverse(index);
         if (!result_node) {
             return NULL;
         }
@@ -952,7 +2936,7 @@ public:
         if (range == EQUAL) {
             return this->Find(key);
         }
-        Node<Key, Value, RankInfo, Number> *result_node = NULL;
+        Node<Key, Value, RankInfo, Number, Policy> *result_node = NULL;
         this->ClosestTraverse(this->root, key, &result_node, range);
         if (!result_node) {
             return NULL;
@@ -968,13 +2952,44 @@ public:
      * @param value - The element value.
      */
     void Insert(const Key key, const Value value) {
-        this->root = this->InsertTraverse(this->root, key, value);
-        if (this->root) {
-            this->root->parent = NULL;
-        }
-        this->max_node = this->FindMax(this->root);
-        this->min_node = this->FindMin(this->root);
-        ++this->size;
+        this->AttachNode(this->AllocateNode(key, value));
+    }
+
+    /**
+     * Inserts a new element or assigns the value of an existing element with the same key.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @note A single descent; an existing element is updated in place without reallocation.
+     * @param key - The element key.
+     * @param value - The element value.
+     * @return {bool} True if a new element was inserted, False if an existing one was assigned.
+     */
+    bool InsertOrAssign(const Key key, const Value value) {
+        return this->InsertOrAssignTraverse(key, value, ParentTag());
+    }
+
+    /**
+     * Mutates the value of an element in place.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @note Only the rank information of the element ancestors is recomputed, no rebalancing is needed.
+     * @tparam Function - Callable object with the signature void(Value &).
+     * @param key - The element key.
+     * @param function - Receives the element value by reference.
+     * @return {bool} True if the element was found o.w False.
+     */
+    template<typename Function>
+    bool Update(const Key key, Function function) {
+        return this->UpdateTraverse(key, function, ParentTag());
+    }
+
+    /**
+     * Changes the key of an element, relocating its node without reallocating it.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param old_key - The current element key.
+     * @param new_key - The new element key.
+     * @return {bool} True if the element was found o.w False.
+     */
+    bool ChangeKey(const Key old_key, const Key new_key) {
+        return this->ChangeKeyTraverse(old_key, new_key, ParentTag());
     }
 
     /**
@@ -984,19 +2999,110 @@ public:
      * @return {bool} True if removed o.w False.
      */
     bool Remove(const Key key) {
-        KeyValuePair<Key, Value> *result = this->Find(key);
-        if (!result) {
-            return false;
+        return this->RemoveTraverse(key, ParentTag());
+    }
+
+    /**
+     * Find the node of an element by its key.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @note A node stays valid (and keeps its address) until it is removed from the tree.
+     * @param key - The element key.
+     * @return {Node<Key, Value, RankInfo, Number, Policy>} node or NULL if not found.
+     */
+    Node<Key, Value, RankInfo, Number, Policy> *FindNode(const Key key) const {
+        return this->FindTraverse(this->root, key);
+    }
+
+    /**
+     * Find the node of an element by its index.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param index - The element index as if it was in a sorted array.
+     * @return {Node<Key, Value, RankInfo, Number, Policy>} node or NULL if the index is out of range.
+     */
+    Node<Key, Value, RankInfo, Number, Policy> *FindIndexNode(Number index) const {
+        static_assert(Policy::rank_augmentation, "FindIndexNode requires the rank augmentation policy.");
+        if (index < 0 || index >= this->size) {
+            return NULL;
         }
-        delete result;
-        this->root = this->RemoveTraverse(this->root, key);
-        if (this->root) {
-            this->root->parent = NULL;
+        return this->FindIndexTraverse(index);
+    }
+
+    /**
+     * Gets the index of an element by its node.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param node - A node of this tree.
+     * @return {Number} Index of the element as if it was in a sorted array.
+     */
+    Number GetIndexOfNode(const Node<Key, Value, RankInfo, Number, Policy> *node) const {
+        static_assert(Policy::parent_pointers && Policy::rank_augmentation,
+                      "GetIndexOfNode requires the parent pointers and rank augmentation policies.");
+        Number index = node->left_child ? node->left_child->rank->rank : 0;
+        while (node->parent) {
+            if (node->parent->right_child == node) {
+                index += (node->parent->left_child ? node->parent->left_child->rank->rank : 0) + 1;
+            }
+            node = node->parent;
         }
-        this->max_node = this->FindMax(this->root);
-        this->min_node = this->FindMin(this->root);
-        --this->size;
-        return true;
+        return index;
+    }
+
+    /**
+     * Gets the node following a given node in sorted order.
+     * @note Worst-Time Complexity: O(log(n)), O(1) amortized over a full scan.
+     * @param node - A node of this tree.
+     * @return {Node<Key, Value, RankInfo, Number, Policy>} next node or NULL if it is the maximum.
+     */
+    Node<Key, Value, RankInfo, Number, Policy> *Next(Node<Key, Value, RankInfo, Number, Policy> *node) const {
+        static_assert(Policy::parent_pointers, "Next requires the parent pointers policy.");
+        return this->NextNode(node);
+    }
+
+    /**
+     * Gets the node preceding a given node in sorted order.
+     * @note Worst-Time Complexity: O(log(n)), O(1) amortized over a full scan.
+     * @param node - A node of this tree.
+     * @return {Node<Key, Value, RankInfo, Number, Policy>} previous node or NULL if it is the minimum.
+     */
+    Node<Key, Value, RankInfo, Number, Policy> *Prev(Node<Key, Value, RankInfo, Number, Policy> *node) const {
+        static_assert(Policy::parent_pointers, "Prev requires the parent pointers policy.");
+        return this->PrevNode(node);
+    }
+
+    /**
+     * Insert new element to the tree and returns its node.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param key - The element key.
+     * @param value - The element value.
+     * @return {Node<Key, Value, RankInfo, Number, Policy>} the node of the new element.
+     */
+    Node<Key, Value, RankInfo, Number, Policy> *InsertNode(const Key key, const Value value) {
+        Node<Key, Value, RankInfo, Number, Policy> *node = this->AllocateNode(key, value);
+        this->AttachNode(node);
+        return node;
+    }
+
+    /**
+     * Removes an element by its node without searching for it.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param node - A node of this tree, deallocated by this call.
+     */
+    void RemoveNode(Node<Key, Value, RankInfo, Number, Policy> *node) {
+        static_assert(Policy::parent_pointers, "RemoveNode requires the parent pointers policy.");
+        this->DetachNode(node);
+        this->FreeNode(node);
+    }
+
+    /**
+     * Changes the key of an element by its node, relocating the node without reallocating it.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param node - A node of this tree.
+     * @param new_key - The new element key.
+     */
+    void ChangeNodeKey(Node<Key, Value, RankInfo, Number, Policy> *node, const Key new_key) {
+        static_assert(Policy::parent_pointers, "ChangeNodeKey requires the parent pointers policy.");
+        this->DetachNode(node);
+        node->key = new_key;
+        this->AttachNode(node);
     }
 
     /**
@@ -1011,10 +3117,11 @@ public:
     AVL::FilterObject<Key, Value, Number>()) const {
         RankInfo *rank = new RankInfo();
         RankInfo tmp = RankInfo();
-        Node<Key, Value, RankInfo, Number> *max = this->max_node;
-        Node<Key, Value, RankInfo, Number> *min = this->min_node;
-        Node<Key, Value, RankInfo, Number> *tmp_max = NULL;
-        Node<Key, Value, RankInfo, Number> *tmp_min = NULL;
+        static_assert(Policy::rank_augmentation, "CollectRank requires the rank augmentation policy.");
+        Node<Key, Value, RankInfo, Number, Policy> *max = this->MaxNode();
+        Node<Key, Value, RankInfo, Number, Policy> *min = this->MinNode();
+        Node<Key, Value, RankInfo, Number, Policy> *tmp_max = NULL;
+        Node<Key, Value, RankInfo, Number, Policy> *tmp_min = NULL;
         Compare comparing_func;
 
         if (filter.max_range) {
@@ -1040,26 +3147,33 @@ public:
             return rank;
         }
 
-        this->GetRelativeRank(tmp, this->root);
-        Number res_index = tmp.rank;
         if (filter.limit > 0) {
+            // Selects by index, with stale counts (approximate rank mode) the selected node is kept in range.
             Number max_index = this->GetIndexOfKey(max->key); // Already 0<=index<n
             Number min_index = this->GetIndexOfKey(min->key); // Already 0<=index<n
             Number index = 0;
+            Node<Key, Value, RankInfo, Number, Policy> *selected = NULL;
             if (filter.reverse) {
                 index = max_index - filter.limit + 1;
                 if (index >= min_index) {
-                    min = FindIndexTraverse(this->root, index + 1, res_index);
+                    selected = this->FindIndexTraverse(index);
                 }
             } else {
                 index = min_index + filter.limit - 1;
                 if (index <= max_index) {
-                    max = FindIndexTraverse(this->root, index + 1, res_index);
+                    selected = this->FindIndexTraverse(index);
                 }
             }
-
-            if (!max || !min) {
-                return rank;
+            if (selected && comparing_func(selected->key, min->key) == LESS_THAN) {
+                selected = min;
+            }
+            if (selected && comparing_func(selected->key, max->key) == GREATER_THAN) {
+                selected = max;
+            }
+            if (selected && filter.reverse) {
+                min = selected;
+            } else if (selected) {
+                max = selected;
             }
 
             if (comparing_func(max->key, min->key) == EQUAL) {
@@ -1070,13 +3184,7 @@ public:
             }
         }
 
-        Node<Key, Value, RankInfo, Number> *mlc = this->GetMostLowerCommonNode(this->root, min, max);
-        tmp = RankInfo();
-        this->CollectRankTraverse(mlc, max, max, rank, LEFT_CHILD);
-        this->CollectRankTraverse(mlc, min, min, rank, RIGHT_CHILD);
-
-        this->GetRelativeRank(tmp, mlc, ROOT);
-        (*rank) += tmp;
+        this->CollectRankBetween(min, max, rank, ParentTag());
         return rank;
     }
 
@@ -1094,6 +3202,8 @@ public:
    * Collect elements within a given filter object.
    * @note Worst-Time Complexity: O(n).
    * @note Worst-Space Complexity: O(n).
+   * @note Elements are ordered by ascending keys, or descending with filter.reverse (the limit then keeps the
+   * largest keys of the range), as ParallelQuery and CollectRank.
    * @param filter - Filter object which contains information considering the traverse.
    * @return {QueryResult<Key, Value, Number>} an object containing result array and total amount of elements.
    */
@@ -1101,17 +3211,17 @@ public:
     Query(const AVL::FilterObject<Key, Value, Number> &filterObject =
     AVL::FilterObject<Key, Value, Number>()) const {
         QueryResult<Key, Value, Number> query = QueryResult<Key, Value, Number>();
-        Node<Key, Value, RankInfo, Number> *result_chain = new Node<Key, Value, RankInfo, Number>();
-        result_chain->parent = result_chain;
+        Node<Key, Value, RankInfo, Number, Policy> *result_chain = new Node<Key, Value, RankInfo, Number, Policy>();
+        result_chain->SetParent(result_chain);
         result_chain->left_child = result_chain;
 
-        this->QueryTraverse(this->root, &query, result_chain, filterObject);
+        this->QueryTraverse(this->root, &query, result_chain, filterObject, ParentTag());
         if (!result_chain) {
             return query;
         }
         query.result = new KeyValuePair<Key, Value>[query.total];
         Number i = 0;
-        Node<Key, Value, RankInfo, Number> *tmp_chain;
+        Node<Key, Value, RankInfo, Number, Policy> *tmp_chain;
         tmp_chain = result_chain;
         result_chain = result_chain->right_child;
         delete tmp_chain;
@@ -1126,6 +3236,198 @@ public:
         return query;
     }
 
+    /**
+     * Collect elements within a given filter object using several threads.
+     * The range is split by index into equal chunks (see PartitionPoints), and every worker walks its chunk
+     * and writes it directly at its offset of a preallocated result array.
+     * @note Worst-Time Complexity: O(n/threads + threads*log(n)).
+     * @note Worst-Space Complexity: O(n).
+     * @note The tree must not be modified during the call. Results are ordered as requested by filter.reverse.
+     * @note While approximate rank mode updates are pending the chunks cannot be split exactly, the elements are
+     * then collected by Query on the calling thread (flush first to keep the workers).
+     * @param filter - Filter object which contains information considering the traverse.
+     * @param threads - Amount of threads, including the calling one (Default: hardware concurrency).
+     * @return {QueryResult<Key, Value, Number>} an object containing result array and total amount of elements.
+     */
+    QueryResult<Key, Value, Number>
+    ParallelQuery(const AVL::FilterObject<Key, Value, Number> &filter = AVL::FilterObject<Key, Value, Number>(),
+                  unsigned threads = std::thread::hardware_concurrency()) const {
+        static_assert(Policy::parent_pointers && Policy::rank_augmentation,
+                      "ParallelQuery requires the parent pointers and rank augmentation policies.");
+        if (this->pending_count > 0) {
+            return this->Query(filter);
+        }
+        QueryResult<Key, Value, Number> query = QueryResult<Key, Value, Number>();
+        Number begin = filter.min_range ? this->CountLessThan(*filter.min_range) : 0;
+        Number end = filter.max_range ? this->CountLessOrEqual(*filter.max_range) : this->size;
+        if (filter.limit > -1 && !filter.FilterFunction) {
+            // Without a filter function the limit is known to cut the range itself.
+            if (filter.reverse) {
+                begin = std::max(begin, end - filter.limit);
+            } else {
+                end = std::min(end, begin + filter.limit);
+            }
+        }
+        if (end <= begin || filter.limit == 0) {
+            return query;
+        }
+        const Number total = end - begin;
+        const Number parts = std::max((Number) 1, std::min((Number) threads, total));
+        const bool mirror = (filter.reverse && !filter.FilterFunction);
+        std::vector<Number> points(parts + 1);
+        std::vector<Number> found(parts);
+        std::vector<std::thread> workers;
+        PartitionRange(begin, end, parts, &points[0]);
+        query.result = new KeyValuePair<Key, Value>[total];
+        for (Number i = 0; i < parts; ++i) {
+            const Number offset = points[i] - begin;
+            KeyValuePair<Key, Value> *output = (mirror ? query.result + (total - 1 - offset) : query.result + offset);
+            if (i + 1 == parts) {
+                this->QueryChunk(points[i], points[i + 1], output, mirror ? -1 : 1, filter.FilterFunction, &found[i]);
+            } else {
+                workers.push_back(std::thread(&AVLRankTree::QueryChunk, this, points[i], points[i + 1], output,
+                                              mirror ? -1 : 1, filter.FilterFunction, &found[i]));
+            }
+        }
+        for (size_t i = 0; i < workers.size(); ++i) {
+            workers[i].join();
+        }
+        if (!filter.FilterFunction) {
+            query.total = total;
+            return query;
+        }
+        // Filtered chunks are shorter than their slots, packs them together.
+        for (Number i = 0; i < parts; ++i) {
+            const Number offset = points[i] - begin;
+            for (Number j = 0; j < found[i]; ++j) {
+                query.result[query.total + j] = query.result[offset + j];
+            }
+            query.total += found[i];
+        }
+        if (filter.reverse) {
+            std::reverse(query.result, query.result + query.total);
+        }
+        if (filter.limit > -1) {
+            query.total = std::min(query.total, filter.limit);
+        }
+        return query;
+    }
+
+    /**
+     * Splits a key range into parts holding the same amount of elements, for parallel consumers.
+     * Part i holds the elements whose indices are in [points[i], points[i + 1]), to be walked from
+     * FindIndexNode(points[i]) with Next.
+     * @note Worst-Time Complexity: O(parts + log(n)).
+     * @note In approximate rank mode the points may be off by up to the error bound (as GetIndexOfKey), so
+     * adjacent parts may overlap or leave gaps, flush first for an exact split.
+     * @param min_key - The key range lower bound (inclusive).
+     * @param max_key - The key range upper bound (inclusive).
+     * @param parts - Amount of parts (at least 1).
+     * @param points - Receives parts+1 element indices, from the first index of the range to its end (exclusive).
+     * @return {Number} Amount of elements within the range.
+     */
+    Number PartitionPoints(const Key &min_key, const Key &max_key, Number parts, Number *points) const {
+        static_assert(Policy::rank_augmentation, "PartitionPoints requires the rank augmentation policy.");
+        const Number begin = this->CountLessThan(min_key);
+        const Number end = std::max(begin, this->CountLessOrEqual(max_key));
+        PartitionRange(begin, end, parts, points);
+        return end - begin;
+    }
+
+    /**
+     * Collect the rank information of many key ranges at once.
+     * A single traversal serves every range: subtrees outside all ranges are skipped, and a subtree within a
+     * single range contributes its aggregated rank information as a whole, so shared path prefixes are visited
+     * once instead of once per range.
+     * @note Worst-Time Complexity: O(k*log(n)*log(k)) - k=amount of ranges.
+     * @note In approximate rank mode the results may be off by up to the error bound (as CollectRank).
+     * @param ranges - Key ranges [first, second] (inclusive), sorted and pairwise disjoint.
+     * @param count - Amount of ranges.
+     * @param results - Receives the rank information of every range (count objects).
+     */
+    void CollectRankBatch(const std::pair<Key, Key> *ranges, Number count, RankInfo *results) const {
+        static_assert(Policy::rank_augmentation, "CollectRankBatch requires the rank augmentation policy.");
+        for (Number i = 0; i < count; ++i) {
+            results[i] = RankInfo();
+        }
+        if (count <= 0 || !this->root) {
+            return;
+        }
+        this->CollectRankBatchTraverse(this->root, ranges, 0, count, results, this->MinNode(), this->MaxNode());
+    }
+
+    /**
+     * Visits the elements of many key ranges in a single traversal, in ascending key order.
+     * @note Worst-Time Complexity: O((k*log(n) + m)*log(k)) - k=amount of ranges, m=amount of visited elements.
+     * @tparam Function - Callable object with the signature void(Number range, const Key &, const Value &).
+     * @param ranges - Key ranges [first, second] (inclusive), sorted and pairwise disjoint.
+     * @param count - Amount of ranges.
+     * @param visitor - Receives the index of the range and every element within it.
+     */
+    template<typename Function>
+    void QueryMultiRange(const std::pair<Key, Key> *ranges, Number count, Function visitor) const {
+        if (count <= 0 || !this->root) {
+            return;
+        }
+        this->QueryMultiRangeTraverse(this->root, ranges, 0, count, visitor, this->MinNode(), this->MaxNode());
+    }
+
+    /**
+     * Verifies every structural invariant of the tree: key order, heights and AVL balance, parent pointers,
+     * rank information (subtree counts, and whole aggregates when RankInfo has operator==), size, min_node
+     * and max_node. The top levels are split into subtrees validated in post-order by parallel workers,
+     * then the levels above them are validated from the subtree results.
+     * @note Worst-Time Complexity: O(n/threads + threads).
+     * @note In approximate rank mode the ancestors of the pending updates are exempt from the rank checks (their
+     * rank information is stale by design), flush first to check every node. The tree must not be modified
+     * during the call.
+     * @param threads - Amount of threads, including the calling one (Default: hardware concurrency).
+     * @param max_issues - Maximal amount of issues kept in the report (all issues are counted) (Default: 64).
+     * @return {ValidationReport<Key, Value, RankInfo, Number, Policy>} the report of the found issues.
+     */
+    ValidationReport<Key, Value, RankInfo, Number, Policy>
+    Validate(unsigned threads = std::thread::hardware_concurrency(), size_t max_issues = 64) const {
+        return this->ValidateTree(threads, max_issues, true);
+    }
+
+    /**
+     * Collect the k elements with the largest values within a key range (by descending value).
+     * @note Requires a rank information with a max_value member (e.g. MaxValueRank).
+     * @note Worst-Time Complexity: O((k + log(n))*log(n)), the range itself is never scanned.
+     * @note Worst-Space Complexity: O(k + log(n)).
+     * @param min_key - The key range lower bound (inclusive).
+     * @param max_key - The key range upper bound (inclusive).
+     * @param k - Maximum amount of elements.
+     * @return {QueryResult<Key, Value, Number>} an object containing result array and total amount of elements.
+     */
+    QueryResult<Key, Value, Number> TopKInRange(const Key &min_key, const Key &max_key, Number k) const {
+        static_assert(Policy::rank_augmentation, "TopKInRange requires the rank augmentation policy.");
+        QueryResult<Key, Value, Number> query = QueryResult<Key, Value, Number>();
+        if (k <= 0 || !this->root) {
+            return query;
+        }
+        std::priority_queue<TopCandidate> candidates;
+        this->PushRangeCandidates(this->root, min_key, max_key, candidates);
+        query.result = new KeyValuePair<Key, Value>[std::min(k, this->size)];
+        while (!candidates.empty() && query.total < k) {
+            const TopCandidate candidate = candidates.top();
+            candidates.pop();
+            if (!candidate.subtree) {
+                query.result[query.total] = KeyValuePair<Key, Value>(candidate.node->key, candidate.node->value);
+                ++query.total;
+                continue;
+            }
+            candidates.push(TopCandidate(candidate.node, false));
+            if (candidate.node->left_child) {
+                candidates.push(TopCandidate(candidate.node->left_child, true));
+            }
+            if (candidate.node->right_child) {
+                candidates.push(TopCandidate(candidate.node->right_child, true));
+            }
+        }
+        return query;
+    }
+
     /**
     * Prints the entire tree.
     * @note Worst-Time Complexity: O(n).
@@ -1148,15 +3450,15 @@ public:
     };
 };
 
-template<typename Key, typename Value, typename Number, class Rank, class Compare>
-std::ostream &operator<<(std::ostream &os, const AVL::AVLRankTree<Value, Key, Rank, Compare, Number> &tree) {
+template<typename Key, typename Value, typename Number, class Rank, class Compare, class Policy>
+std::ostream &operator<<(std::ostream &os, const AVL::AVLRankTree<Value, Key, Rank, Compare, Number, Policy> &tree) {
     tree.PrintTree(os);
     os << std::endl;
     return os;
 }
 
-template<typename Key, typename Value, typename Number, class Rank, class Compare>
-std::ostream &operator<<(std::ostream &os, const AVL::AVLRankTree<Value, Key, Rank, Compare, Number> *tree) {
+template<typename Key, typename Value, typename Number, class Rank, class Compare, class Policy>
+std::ostream &operator<<(std::ostream &os, const AVL::AVLRankTree<Value, Key, Rank, Compare, Number, Policy> *tree) {
     tree->PrintTree(os);
     os << std::endl;
     return os;
@@ -0,0 +1,412 @@
+/**
+ * Bidirectional rank map built on two AVL rank trees.
+ *
+ * @file avl_bimap.hpp
+ *
+ * @brief Stores each entry once and indexes it both by key and by value, each index with its own ranks.
+ *
+ * @author Liav Barsheshet
+ * Contact: liavbarsheshet@gmail.com
+ *
+ * This implementation is free: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This implementation is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+#include "avl.hpp"
+
+#ifndef _AVL_BIMAP_HPP
+#define _AVL_BIMAP_HPP
+
+namespace AVL {
+    typedef enum {
+        BY_KEY = 0, BY_VALUE = 1
+    } BIMAP_INDEX;
+
+    template<typename Key, typename Value, typename Number, class KeyRankInfo, class ValueRankInfo>
+    class BiRankSlot;
+
+    template<class RankInfo, typename Key, class Slot>
+    class BiKeyRank;
+
+    template<class RankInfo, class Entry>
+    class BiValueRank;
+
+    template<class Entry, class KeyCompare, class ValueCompare>
+    class BiValueOrder;
+
+    template<typename Key, typename Value,
+            typename Number = long long,
+            class KeyRankInfo = DefaultRank<Key, Value, Number>,
+            class ValueRankInfo = DefaultRank<Key, Value, Number>,
+            class KeyCompare = CompareFunc<Key>,
+            class ValueCompare = CompareFunc<Value>>
+    class BiRankMap;
+}
+
+/**
+ * Class: Value slot of an entry in the key index, embedding the node of the entry in the value index.
+ * The value node and its rank information live inside the slot, so an entry is a single allocation (plus the key
+ * index rank) and the value index never allocates.
+ * @tparam Key - The type/class of the key.
+ * @tparam Value - The type/class of the value.
+ * @tparam Number - Class/Primitive for numbers representation.
+ * @tparam KeyRankInfo - Rank information of the key index.
+ * @tparam ValueRankInfo - Rank information of the value index.
+ */
+template<typename Key, typename Value, typename Number, class KeyRankInfo, class ValueRankInfo>
+class AVL::BiRankSlot {
+public:
+    typedef AVL::BiRankSlot<Key, Value, Number, KeyRankInfo, ValueRankInfo> Slot;
+    typedef AVL::Node<Key, Slot, AVL::BiKeyRank<KeyRankInfo, Key, Slot>, Number> Entry;
+    typedef AVL::BiValueRank<ValueRankInfo, Entry> ValueRank;
+    typedef AVL::Node<Entry *, bool, ValueRank, Number> ValueNode;
+
+private:
+    typename std::aligned_storage<sizeof(ValueRank), alignof(ValueRank)>::type value_rank;
+
+public:
+    Value value;
+    ValueNode by_value;
+
+    BiRankSlot(Value value) :
+            value(value),
+            by_value(NULL, true, new(&this->value_rank) ValueRank()) {}
+
+    /* A copy is detached from the value index (it only carries the value). */
+    BiRankSlot(const Slot &slot) :
+            value(slot.value),
+            by_value(NULL, true, new(&this->value_rank) ValueRank()) {}
+
+    Slot &operator=(const Slot &slot) = delete;
+
+    ~BiRankSlot() {
+        this->by_value.DestroyRankInPlace();
+    }
+};
+
+/**
+ * Class: Rank information of the key index, built from the key and the value of the entry.
+ * @tparam RankInfo - The user rank information (RankInfo protocol over Key and Value).
+ * @tparam Key - The type/class of the key.
+ * @tparam Slot - The value slot of the key index.
+ */
+template<class RankInfo, typename Key, class Slot>
+class AVL::BiKeyRank : public RankInfo {
+public:
+    BiKeyRank() :
+            RankInfo() {}
+
+    BiKeyRank(const Key &key, const Slot &slot) :
+            RankInfo(key, slot.value) {}
+};
+
+/**
+ * Class: Rank information of the value index, built from the key and the value of the referenced entry.
+ * @tparam RankInfo - The user rank information (RankInfo protocol over Key and Value).
+ * @tparam Entry - The entry (node of the key index).
+ */
+template<class RankInfo, class Entry>
+class AVL::BiValueRank : public RankInfo {
+public:
+    BiValueRank() :
+            RankInfo() {}
+
+    BiValueRank(Entry *entry, bool) :
+            RankInfo(entry->key, entry->value.value) {}
+};
+
+/**
+ * Class: Orders the entries of the value index by value, ties ordered by key.
+ * @tparam Entry - The entry (node of the key index).
+ * @tparam KeyCompare - Compare Function Object of the keys.
+ * @tparam ValueCompare - Compare Function Object of the values.
+ */
+template<class Entry, class KeyCompare, class ValueCompare>
+class AVL::BiValueOrder {
+    KeyCompare key_compare;
+    ValueCompare value_compare;
+
+public:
+    AVL::COMPARE_RESULT operator()(const Entry *entry1, const Entry *entry2) const {
+        const AVL::COMPARE_RESULT result = this->value_compare(entry1->value.value, entry2->value.value);
+        if (result != EQUAL) {
+            return result;
+        }
+        return this->key_compare(entry1->key, entry2->key);
+    }
+};
+
+/**
+ * Class: Bidirectional Rank Map.
+ * Every entry is stored once, in a rank tree ordered by key (keys are unique), and also linked in a second rank
+ * tree ordered by value (ties ordered by key). Both indices are AVLRankTree instances with their own rank
+ * information, so "rank by key" and "rank by value" are O(log(n)), and changing a value only relocates the
+ * entry in the value index.
+ * @note The key index is a protected base; the value index is a member balanced over a second link set (parent,
+ * children, height and rank) embedded in every entry, so an entry costs two allocations (node and key rank)
+ * instead of four, and the value index adds a node body (56 bytes with 64-bit pointers) and the value rank per entry.
+ * @tparam Key - The type/class of the key.
+ * @tparam Value - The type/class of the value.
+ * @tparam Number - Class/Primitive for numbers representation.
+ * @tparam KeyRankInfo - Rank information aggregated along the key index (RankInfo protocol).
+ * @tparam ValueRankInfo - Rank information aggregated along the value index (RankInfo protocol).
+ * @tparam KeyCompare - Compare Function Object of the keys.
+ * @tparam ValueCompare - Compare Function Object of the values.
+ */
+template<typename Key, typename Value, typename Number, class KeyRankInfo, class ValueRankInfo, class KeyCompare,
+        class ValueCompare>
+class AVL::BiRankMap : protected AVL::AVLRankTree<Key, AVL::BiRankSlot<Key, Value, Number, KeyRankInfo,
+        ValueRankInfo>, Number, AVL::BiKeyRank<KeyRankInfo, Key, AVL::BiRankSlot<Key, Value, Number, KeyRankInfo,
+        ValueRankInfo>>, KeyCompare> {
+protected:
+    typedef AVL::BiRankSlot<Key, Value, Number, KeyRankInfo, ValueRankInfo> Slot;
+    typedef typename Slot::Entry Entry;
+    typedef typename Slot::ValueNode ValueNode;
+    typedef AVL::BiKeyRank<KeyRankInfo, Key, Slot> KeyRank;
+    typedef typename Slot::ValueRank ValueRank;
+    typedef AVL::AVLRankTree<Key, Slot, Number, KeyRank, KeyCompare> Tree;
+    typedef AVL::AVLRankTree<Entry *, bool, Number, ValueRank, AVL::BiValueOrder<Entry, KeyCompare, ValueCompare>>
+            ValueTree;
+
+    /* The value index, balanced over the value nodes embedded in the entries (it never allocates nor frees). */
+    class ValueIndex : public ValueTree {
+    public:
+        ~ValueIndex() {
+            // The nodes belong to the entries, deallocated by the key index.
+            this->root = NULL;
+        }
+
+        void Link(ValueNode *node) {
+            this->AttachNode(node);
+        }
+
+        void Unlink(ValueNode *node) {
+            this->DetachNode(node);
+        }
+
+        ValueNode *Root() const {
+            return this->root;
+        }
+
+        ValueNode *First() const {
+            return this->MinNode();
+        }
+    };
+
+    ValueIndex values;
+    ValueCompare value_compare;
+
+    /* Sets the value of an entry, refreshing its key index ranks and relocating it in the value index. */
+    void AssignValue(Entry *entry, const Value &value) {
+        entry->value.value = value;
+        this->UpdateRankUpwards(entry);
+        this->values.ChangeNodeKey(&entry->value.by_value, entry);
+    }
+
+    void RemoveEntry(Entry *entry) {
+        this->values.Unlink(&entry->value.by_value);
+        Tree::RemoveNode(entry);
+    }
+
+    Entry *SelectEntry(Number position, BIMAP_INDEX index) const {
+        if (index == BY_KEY) {
+            return Tree::FindIndexNode(position);
+        }
+        const ValueNode *node = this->values.FindIndexNode(position);
+        return node ? node->key : NULL;
+    }
+
+    /* Counts the leading entries of the value index whose value satisfies a predicate monotone along the index. */
+    template<class Predicate>
+    Number CountValuesWhile(Predicate predicate) const {
+        const ValueNode *node = this->values.Root();
+        Number count = 0;
+        while (node) {
+            if (predicate(node->key->value.value)) {
+                count += (node->left_child ? node->left_child->rank->rank : 0) + 1;
+                node = node->right_child;
+            } else {
+                node = node->left_child;
+            }
+        }
+        return count;
+    }
+
+    /* Aggregates the rank information of the first `count` elements of an index, from its root. */
+    template<class RankInfo, class IndexNode>
+    static RankInfo CollectPrefix(const IndexNode *node, Number count) {
+        RankInfo rank = RankInfo();
+        while (node && count > 0) {
+            const Number left = node->left_child ? node->left_child->rank->rank : 0;
+            if (count <= left) {
+                node = node->left_child;
+                continue;
+            }
+            if (node->left_child) {
+                rank += *node->left_child->rank;
+            }
+            rank += RankInfo(node->key, node->value);
+            count -= left + 1;
+            node = node->right_child;
+        }
+        return rank;
+    }
+
+public:
+    /**
+     * Constructor: Constructs an empty bidirectional map.
+     * @note Worst-Time Complexity: O(1).
+     */
+    BiRankMap() :
+            Tree(),
+            values(),
+            value_compare() {}
+
+    BiRankMap(const BiRankMap &map) = delete;
+
+    BiRankMap &operator=(const BiRankMap &map) = delete;
+
+    using Tree::GetSize;
+
+    /**
+     * Inserts a new entry.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param key - The entry key.
+     * @param value - The entry value.
+     * @return {bool} True if inserted, False if the key already exists.
+     */
+    bool Insert(const Key key, const Value value) {
+        if (this->FindNode(key)) {
+            return false;
+        }
+        Entry *entry = Tree::InsertNode(key, Slot(value));
+        entry->value.by_value.key = entry;
+        this->values.Link(&entry->value.by_value);
+        return true;
+    }
+
+    /**
+     * Changes the value of an entry, relocating it in the value index only.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param key - The entry key.
+     * @param value - The new value.
+     * @return {bool} True if the entry was found o.w False.
+     */
+    bool SetValue(const Key key, const Value value) {
+        Entry *entry = this->FindNode(key);
+        if (!entry) {
+            return false;
+        }
+        this->AssignValue(entry, value);
+        return true;
+    }
+
+    /**
+     * Removes an entry.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param key - The entry key.
+     * @return {bool} True if removed o.w False.
+     */
+    bool Remove(const Key key) {
+        Entry *entry = this->FindNode(key);
+        if (!entry) {
+            return false;
+        }
+        this->RemoveEntry(entry);
+        return true;
+    }
+
+    /**
+     * Find an entry by its key.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param key - The entry key.
+     * @param value - Receives the entry value.
+     * @return {bool} True if found o.w False.
+     */
+    bool Find(const Key key, Value &value) const {
+        const Entry *entry = this->FindNode(key);
+        if (!entry) {
+            return false;
+        }
+        value = entry->value.value;
+        return true;
+    }
+
+    /**
+     * Gets the index of an entry within an index.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param key - The entry key.
+     * @param index - BY_KEY (Default) or BY_VALUE (ordered by value, then key).
+     * @return {Number} Index of the entry as if the index was a sorted array, -1 if not found.
+     */
+    Number GetIndexOfKey(const Key key, BIMAP_INDEX index = BY_KEY) const {
+        const Entry *entry = this->FindNode(key);
+        if (!entry) {
+            return -1;
+        }
+        if (index == BY_KEY) {
+            return Tree::GetIndexOfNode(entry);
+        }
+        return this->values.GetIndexOfNode(&entry->value.by_value);
+    }
+
+    /**
+     * Find an entry by its index within an index.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param position - The entry index as if the index was a sorted array.
+     * @param key - Receives the entry key.
+     * @param value - Receives the entry value.
+     * @param index - BY_KEY (Default) or BY_VALUE (ordered by value, then key).
+     * @return {bool} True if the position is in range o.w False.
+     */
+    bool FindIndex(const Number position, Key &key, Value &value, BIMAP_INDEX index = BY_KEY) const {
+        const Entry *entry = this->SelectEntry(position, index);
+        if (!entry) {
+            return false;
+        }
+        key = entry->key;
+        value = entry->value.value;
+        return true;
+    }
+
+    /**
+     * Counts the entries whose value is less than a given value.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param value - The bounding value.
+     * @return {Number} Amount of entries with a smaller value.
+     */
+    Number CountValuesLessThan(const Value &value) const {
+        const ValueCompare &compare = this->value_compare;
+        return this->CountValuesWhile([&compare, &value](const Value &entry_value) {
+            return compare(entry_value, value) == LESS_THAN;
+        });
+    }
+
+    /**
+     * Collects the rank information of the first entries ordered by key.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param count - Amount of leading entries (clamped to the size).
+     * @return {KeyRankInfo} Rank information aggregated over those entries.
+     */
+    KeyRankInfo CollectKeyRank(const Number count) const {
+        return CollectPrefix<KeyRank>(this->root, count);
+    }
+
+    /**
+     * Collects the rank information of the first entries ordered by value (then key).
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param count - Amount of leading entries (clamped to the size).
+     * @return {ValueRankInfo} Rank information aggregated over those entries.
+     */
+    ValueRankInfo CollectValueRank(const Number count) const {
+        return CollectPrefix<ValueRank>(this->values.Root(), count);
+    }
+};
+
+#endif
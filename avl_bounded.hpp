@@ -0,0 +1,185 @@
+/**
+ * Capacity-bounded (top-N) mode of the Generic AVL (Balanced) Rank Tree.
+ *
+ * @file avl_bounded.hpp
+ *
+ * @brief Rank tree keeping only the N greatest keys, evicting its minimum on overflow.
+ *
+ * @author Liav Barsheshet
+ * Contact: liavbarsheshet@gmail.com
+ *
+ * This implementation is free: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This implementation is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+#include "avl.hpp"
+
+#ifndef _AVL_BOUNDED_HPP
+#define _AVL_BOUNDED_HPP
+
+namespace AVL {
+    template<typename Key, typename Value,
+            typename Number = long long,
+            class RankInfo = DefaultRank<Key, Value, Number>,
+            class Compare = CompareFunc<Key>>
+    class BoundedRankTree;
+}
+
+/**
+ * Class: Bounded Rank Tree.
+ * Keeps at most `capacity` elements, the greatest keys seen. Once full, an insertion of a key which is not
+ * greater than the current minimum is rejected in O(1) (compared against min_node), and any other insertion
+ * evicts the minimum by its node (no search) and reuses that node for the new element, so memory stays constant
+ * and every insertion costs O(log(capacity)) regardless of the stream size.
+ * @note The rank tree is a protected base: elements only enter through the bounded insertions and leave by
+ * eviction, and only the read interface of the tree is re-exported.
+ * @tparam Key - The type/class of the key.
+ * @tparam Value - The type/class of the value.
+ * @tparam Number - Class/Primitive for numbers representation.
+ * @tparam RankInfo - Class of rank information.
+ * @tparam Compare - Compare Function Object of the keys.
+ */
+template<typename Key, typename Value, typename Number, class RankInfo, class Compare>
+class AVL::BoundedRankTree : protected AVL::AVLRankTree<Key, Value, Number, RankInfo, Compare> {
+    typedef AVL::AVLRankTree<Key, Value, Number, RankInfo, Compare> Tree;
+    typedef AVL::Node<Key, Value, RankInfo, Number> TreeNode;
+
+    Number capacity;
+
+    TreeNode *BoundedInsert(const Key &key, const Value &value) {
+        if (this->capacity <= 0) {
+            return NULL;
+        }
+        if (this->size < this->capacity) {
+            return Tree::InsertNode(key, value);
+        }
+        if (this->compare(key, this->min_node->key) != GREATER_THAN) {
+            return NULL;
+        }
+        // Evicts the minimum and reuses its node for the new element.
+        TreeNode *node = this->min_node;
+        this->DetachNode(node);
+        node->key = key;
+        node->value = value;
+        this->AttachNode(node);
+        return node;
+    }
+
+public:
+    using Tree::GetSize;
+    using Tree::GetHeight;
+    using Tree::GetIndexOfKey;
+    using Tree::CountLessThan;
+    using Tree::CountLessOrEqual;
+    using Tree::Find;
+    using Tree::FindNode;
+    using Tree::FindIndex;
+    using Tree::FindIndexNode;
+    using Tree::GetIndexOfNode;
+    using Tree::Next;
+    using Tree::Prev;
+    using Tree::GetMin;
+    using Tree::GetMax;
+    using Tree::Closest;
+    using Tree::CollectRank;
+    using Tree::Query;
+    using Tree::ParallelQuery;
+    using Tree::PartitionPoints;
+    using Tree::CollectRankBatch;
+    using Tree::QueryMultiRange;
+    using Tree::TopKInRange;
+    using Tree::Validate;
+    using Tree::PrintTree;
+    using Tree::operator[];
+
+    /**
+     * Constructor: Constructs an empty bounded rank tree.
+     * @note Worst-Time Complexity: O(1).
+     * @param capacity - Maximal amount of elements.
+     */
+    explicit BoundedRankTree(Number capacity) :
+            Tree(),
+            capacity(capacity) {}
+
+    BoundedRankTree(const BoundedRankTree &tree) = delete;
+
+    BoundedRankTree &operator=(const BoundedRankTree &tree) = delete;
+
+    /**
+     * Gets the maximal amount of elements.
+     * @note Worst-Time Complexity: O(1).
+     * @return {Number} The capacity.
+     */
+    Number GetCapacity() const {
+        return this->capacity;
+    }
+
+    /**
+     * Sets the maximal amount of elements, evicting the smallest keys if the tree holds more.
+     * @note Worst-Time Complexity: O(k*log(n)) - k=evicted elements.
+     * @param capacity - Maximal amount of elements.
+     * @return {Number} Amount of evicted elements.
+     */
+    Number SetCapacity(Number capacity) {
+        this->capacity = capacity;
+        Number evicted = 0;
+        while (this->size > 0 && this->size > this->capacity) {
+            this->RemoveNode(this->min_node);
+            ++evicted;
+        }
+        return evicted;
+    }
+
+    /**
+     * Inserts a new element, evicting the minimum if the tree is full.
+     * @note Worst-Time Complexity: O(log(capacity)), O(1) if rejected.
+     * @param key - The element key.
+     * @param value - The element value.
+     * @return {bool} True if inserted, False if rejected (full and key not greater than the minimum).
+     */
+    bool Insert(const Key key, const Value value) {
+        return this->BoundedInsert(key, value) != NULL;
+    }
+
+    /**
+     * Inserts a new element and returns its node, evicting the minimum if the tree is full.
+     * @note Worst-Time Complexity: O(log(capacity)), O(1) if rejected.
+     * @note The node of an evicted element is reused, so its handle then refers to the new element.
+     * @param key - The element key.
+     * @param value - The element value.
+     * @return {Node<Key, Value, RankInfo, Number>} the node of the new element or NULL if rejected.
+     */
+    TreeNode *InsertNode(const Key key, const Value value) {
+        return this->BoundedInsert(key, value);
+    }
+
+    /**
+     * Inserts a new element or assigns the value of an existing element with the same key.
+     * @note Worst-Time Complexity: O(log(capacity)).
+     * @param key - The element key.
+     * @param value - The element value.
+     * @return {bool} True if a new element was inserted, False if assigned or rejected.
+     */
+    bool InsertOrAssign(const Key key, const Value value) {
+        if (this->size >= this->capacity && this->size > 0 &&
+            this->compare(key, this->min_node->key) == LESS_THAN) {
+            return false;
+        }
+        TreeNode *node = this->FindTraverse(this->root, key);
+        if (node) {
+            node->value = value;
+            this->UpdateRankUpwards(node);
+            return false;
+        }
+        return this->BoundedInsert(key, value) != NULL;
+    }
+};
+
+#endif
@@ -0,0 +1,339 @@
+/**
+ * Hot-key lookup cache in front of the Generic AVL (Balanced) Rank Tree.
+ *
+ * @file avl_cache.hpp
+ *
+ * @brief AVL rank tree whose key lookups first probe a small direct-mapped key hash to node cache.
+ *
+ * @author Liav Barsheshet
+ * Contact: liavbarsheshet@gmail.com
+ *
+ * This implementation is free: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This implementation is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+#include <atomic>
+#include <functional>
+#include "avl.hpp"
+
+#ifndef _AVL_CACHE_HPP
+#define _AVL_CACHE_HPP
+
+namespace AVL {
+    template<typename Key, typename Value,
+            typename Number = long long,
+            class RankInfo = DefaultRank<Key, Value, Number>,
+            class Compare = CompareFunc<Key>,
+            class Hash = std::hash<Key>>
+    class CachedRankTree;
+}
+
+/**
+ * Class: Cached AVL Rank Tree.
+ * Key lookups (Find, FindNode, Update) probe a direct-mapped cache of key hash to node before descending,
+ * so repeated lookups of hot keys cost O(1). A hit is verified against the node key, and a slot is
+ * invalidated whenever its node is removed or its key changes.
+ * @note The rank tree is a protected base: every modification goes through this class, which keeps the slots
+ * valid, and the rest of the tree interface is re-exported (except the approximate rank mode).
+ * @note Const lookups may run concurrently: the slots they write are relaxed atomics, and the hit/miss counters
+ * are sharded per thread (summed on read), so concurrent readers do not contend on a single counter.
+ * @tparam Key - The type/class of the key.
+ * @tparam Value - The type/class of the value.
+ * @tparam Number - Class/Primitive for numbers representation.
+ * @tparam RankInfo - Class of rank information.
+ * @tparam Compare - Compare Function Object of the keys.
+ * @tparam Hash - Hash Function Object of the keys.
+ */
+template<typename Key, typename Value, typename Number, class RankInfo, class Compare, class Hash>
+class AVL::CachedRankTree : protected AVL::AVLRankTree<Key, Value, Number, RankInfo, Compare> {
+    typedef AVL::AVLRankTree<Key, Value, Number, RankInfo, Compare> Tree;
+    typedef AVL::Node<Key, Value, RankInfo, Number> TreeNode;
+
+    static const size_t COUNTER_SHARDS = 16;
+
+    /* Hit and miss counters of the threads mapped to a shard, padded to keep shards on separate cache lines. */
+    class CounterShard {
+    public:
+        std::atomic<long long> hits;
+        std::atomic<long long> misses;
+        char padding[64];
+
+        CounterShard() :
+                hits(0),
+                misses(0) {}
+    };
+
+    /* Const lookups fill the slots, so they are relaxed atomics (readers only share live nodes). */
+    mutable std::atomic<TreeNode *> *cache;
+    size_t cache_mask;
+    Hash hash;
+
+    mutable CounterShard counters[COUNTER_SHARDS];
+
+    /* Shard of the calling thread, threads are spread over the shards in order of their first lookup. */
+    static CounterShard &Shard(CounterShard *counters) {
+        static std::atomic<size_t> next_shard(0);
+        static thread_local size_t shard = next_shard.fetch_add(1, std::memory_order_relaxed) % COUNTER_SHARDS;
+        return counters[shard];
+    }
+
+    std::atomic<TreeNode *> &Slot(const Key &key) const {
+        return this->cache[this->hash(key) & this->cache_mask];
+    }
+
+    void Invalidate(const TreeNode *node) {
+        std::atomic<TreeNode *> &slot = this->Slot(node->key);
+        if (slot.load(std::memory_order_relaxed) == node) {
+            slot.store(NULL, std::memory_order_relaxed);
+        }
+    }
+
+    TreeNode *CachedFind(const Key &key) const {
+        std::atomic<TreeNode *> &slot = this->Slot(key);
+        TreeNode *cached = slot.load(std::memory_order_relaxed);
+        CounterShard &shard = Shard(this->counters);
+        if (cached && this->compare(key, cached->key) == EQUAL) {
+            shard.hits.fetch_add(1, std::memory_order_relaxed);
+            return cached;
+        }
+        shard.misses.fetch_add(1, std::memory_order_relaxed);
+        TreeNode *node = this->FindTraverse(this->root, key);
+        if (node) {
+            slot.store(node, std::memory_order_relaxed);
+        }
+        return node;
+    }
+
+public:
+    using Tree::GetSize;
+    using Tree::GetHeight;
+    using Tree::GetIndexOfKey;
+    using Tree::CountLessThan;
+    using Tree::CountLessOrEqual;
+    using Tree::SetArenaPages;
+    using Tree::GetArenaPages;
+    using Tree::GetMax;
+    using Tree::GetMin;
+    using Tree::FindIndex;
+    using Tree::Closest;
+    using Tree::Insert;
+    using Tree::InsertOrAssign;
+    using Tree::FindIndexNode;
+    using Tree::GetIndexOfNode;
+    using Tree::Next;
+    using Tree::Prev;
+    using Tree::InsertNode;
+    using Tree::CollectRank;
+    using Tree::operator[];
+    using Tree::Query;
+    using Tree::ParallelQuery;
+    using Tree::PartitionPoints;
+    using Tree::CollectRankBatch;
+    using Tree::QueryMultiRange;
+    using Tree::Validate;
+    using Tree::TopKInRange;
+    using Tree::PrintTree;
+
+    /**
+     * Constructor: Constructs an empty cached AVL rank tree.
+     * @note Worst-Time Complexity: O(slots).
+     * @param slots - Amount of cache slots, rounded up to a power of 2 (Default: 4096).
+     */
+    explicit CachedRankTree(size_t slots = 4096) :
+            Tree(),
+            cache(NULL),
+            cache_mask(0),
+            hash(),
+            counters() {
+        size_t capacity = 1;
+        while (capacity < slots) {
+            capacity <<= 1;
+        }
+        this->cache = new std::atomic<TreeNode *>[capacity];
+        this->cache_mask = capacity - 1;
+        this->ClearCache();
+    }
+
+    CachedRankTree(const CachedRankTree &tree) = delete;
+
+    CachedRankTree &operator=(const CachedRankTree &tree) = delete;
+
+    /**
+     * Destructor: Deallocates the cache and the entire tree.
+     * @note Worst-Time Complexity: O(n).
+     */
+    ~CachedRankTree() {
+        delete[] this->cache;
+    }
+
+    /**
+     * Find an element by its key.
+     * @note Worst-Time Complexity: O(log(n)), O(1) on a cache hit.
+     * @param key - The element key.
+     * @return {KeyValuePair<Key, Value>} element or NULL if not found.
+     */
+    AVL::KeyValuePair<Key, Value> *Find(const Key key) const {
+        TreeNode *node = this->CachedFind(key);
+        if (!node) {
+            return NULL;
+        }
+        return new AVL::KeyValuePair<Key, Value>(node->key, node->value);
+    }
+
+    /**
+     * Find the node of an element by its key.
+     * @note Worst-Time Complexity: O(log(n)), O(1) on a cache hit.
+     * @param key - The element key.
+     * @return {Node<Key, Value, RankInfo, Number>} node or NULL if not found.
+     */
+    TreeNode *FindNode(const Key key) const {
+        return this->CachedFind(key);
+    }
+
+    /**
+     * Mutates the value of an element in place.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @tparam Function - Callable object with the signature void(Value &).
+     * @param key - The element key.
+     * @param function - Receives the element value by reference.
+     * @return {bool} True if the element was found o.w False.
+     */
+    template<typename Function>
+    bool Update(const Key key, Function function) {
+        TreeNode *node = this->CachedFind(key);
+        if (!node) {
+            return false;
+        }
+        function(node->value);
+        this->UpdateRankUpwards(node);
+        return true;
+    }
+
+    /**
+     * Removes an element from the tree.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param key - The element key.
+     * @return {bool} True if removed o.w False.
+     */
+    bool Remove(const Key key) {
+        TreeNode *node = this->CachedFind(key);
+        if (!node) {
+            return false;
+        }
+        this->RemoveNode(node);
+        return true;
+    }
+
+    /**
+     * Removes an element by its node without searching for it.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param node - A node of this tree, deallocated by this call.
+     */
+    void RemoveNode(TreeNode *node) {
+        this->Invalidate(node);
+        Tree::RemoveNode(node);
+    }
+
+    /**
+     * Changes the key of an element, relocating its node without reallocating it.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param old_key - The current element key.
+     * @param new_key - The new element key.
+     * @return {bool} True if the element was found o.w False.
+     */
+    bool ChangeKey(const Key old_key, const Key new_key) {
+        TreeNode *node = this->CachedFind(old_key);
+        if (!node) {
+            return false;
+        }
+        this->ChangeNodeKey(node, new_key);
+        return true;
+    }
+
+    /**
+     * Changes the key of an element by its node, relocating the node without reallocating it.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param node - A node of this tree.
+     * @param new_key - The new element key.
+     */
+    void ChangeNodeKey(TreeNode *node, const Key new_key) {
+        this->Invalidate(node);
+        Tree::ChangeNodeKey(node, new_key);
+    }
+
+    /**
+     * Relayouts the tree into a contiguous arena (see AVLRankTree::Compact) and empties the cache.
+     * @note Worst-Time Complexity: O(n*log(log(n))).
+     * @param rebuild - Also rebuild the tree to perfect balance (Default: false).
+     */
+    void Compact(bool rebuild = false) {
+        Tree::Compact(rebuild);
+        this->ClearCache();
+    }
+
+    /**
+     * Reserves arena slots for future insertions (see AVLRankTree::Reserve) and empties the cache.
+     * @note Worst-Time Complexity: O(n*log(log(n))) if the capacity grows, o.w O(slots).
+     * @param capacity - Amount of elements the arena should hold.
+     */
+    void Reserve(Number capacity) {
+        Tree::Reserve(capacity);
+        this->ClearCache();
+    }
+
+    /**
+     * Empties the cache without touching the tree.
+     * @note Worst-Time Complexity: O(slots).
+     */
+    void ClearCache() {
+        for (size_t i = 0; i <= this->cache_mask; ++i) {
+            this->cache[i].store(NULL, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * Gets the amount of cached lookups.
+     * @note Worst-Time Complexity: O(shards).
+     * @return {Number} Amount of lookups served by the cache.
+     */
+    Number GetCacheHits() const {
+        long long hits = 0;
+        for (size_t i = 0; i < COUNTER_SHARDS; ++i) {
+            hits += this->counters[i].hits.load(std::memory_order_relaxed);
+        }
+        return (Number) hits;
+    }
+
+    /**
+     * Gets the amount of lookups that descended the tree.
+     * @note Worst-Time Complexity: O(shards).
+     * @return {Number} Amount of lookups missing the cache.
+     */
+    Number GetCacheMisses() const {
+        long long misses = 0;
+        for (size_t i = 0; i < COUNTER_SHARDS; ++i) {
+            misses += this->counters[i].misses.load(std::memory_order_relaxed);
+        }
+        return (Number) misses;
+    }
+
+    /**
+     * Resets the hit and miss counters.
+     * @note Worst-Time Complexity: O(shards).
+     */
+    void ResetCacheStats() {
+        for (size_t i = 0; i < COUNTER_SHARDS; ++i) {
+            this->counters[i].hits.store(0, std::memory_order_relaxed);
+            this->counters[i].misses.store(0, std::memory_order_relaxed);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,438 @@
+/**
+ * Compact AVL (Balanced) Rank Tree for small trivially copyable keys and values.
+ *
+ * @file avl_compact.hpp
+ *
+ * @brief Index based AVL rank tree with 32-bit child links and a packed size/balance word.
+ *
+ * @author Liav Barsheshet
+ * Contact: liavbarsheshet@gmail.com
+ *
+ * This implementation is free: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This implementation is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+#include <stdint.h>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include "avl.hpp"
+
+#ifndef _AVL_COMPACT_HPP
+#define _AVL_COMPACT_HPP
+
+namespace AVL {
+    template<typename Key, typename Value>
+    class CompactNode;
+
+    template<typename Key, typename Value, typename Number = long long>
+    class CompactAVLTree;
+}
+
+/**
+ * Class: Represents nodes inside the Compact AVL Tree (20 bytes for 32-bit keys and values).
+ * The low 30 bits of size_balance hold the subtree size and the high 2 bits the balance factor + 1.
+ * @tparam Key - The type/class of the key.
+ * @tparam Value - The type/class of the value.
+ */
+template<typename Key, typename Value>
+class AVL::CompactNode {
+public:
+    Key key;
+    Value value;
+    /* Left and right child indices, 0 is the empty subtree. */
+    uint32_t child[2];
+    uint32_t size_balance;
+};
+
+/**
+ * Class: Represents a Compact AVL Rank Tree.
+ * Nodes live in a single array and link to each other by 32-bit indices (index 0 is the empty subtree),
+ * removed nodes are recycled through a free list. Descents select the child with the result of a single
+ * operator< (no three way compare), which compiles to a conditional move instead of a branch.
+ * @note Supports up to 2^30 - 1 elements. Equal keys are allowed (placed to the right).
+ * @tparam Key - The type/class of the key (trivially copyable, requires operator<).
+ * @tparam Value - The type/class of the value (trivially copyable).
+ * @tparam Number - Class/Primitive for numbers representation.
+ */
+template<typename Key, typename Value, typename Number>
+class AVL::CompactAVLTree {
+protected:
+    static_assert(std::is_trivially_copyable<Key>::value, "CompactAVLTree requires a trivially copyable key.");
+    static_assert(std::is_trivially_copyable<Value>::value, "CompactAVLTree requires a trivially copyable value.");
+
+    static const uint32_t SIZE_MASK = 0x3FFFFFFFu;
+    static const uint32_t BALANCE_SHIFT = 30;
+
+    AVL::CompactNode<Key, Value> *nodes;
+    uint32_t capacity;
+    uint32_t used;
+    uint32_t free_list;
+    uint32_t root;
+
+    uint32_t Size(uint32_t index) const {
+        return this->nodes[index].size_balance & SIZE_MASK;
+    }
+
+    /* Balance factor: height(right) - height(left). */
+    int GetBalance(uint32_t index) const {
+        return (int) (this->nodes[index].size_balance >> BALANCE_SHIFT) - 1;
+    }
+
+    void SetBalance(uint32_t index, int balance) {
+        this->nodes[index].size_balance = (this->nodes[index].size_balance & SIZE_MASK) |
+                                          ((uint32_t) (balance + 1) << BALANCE_SHIFT);
+    }
+
+    void UpdateSize(uint32_t index) {
+        AVL::CompactNode<Key, Value> &node = this->nodes[index];
+        node.size_balance = (node.size_balance & ~SIZE_MASK) |
+                            (this->Size(node.child[0]) + this->Size(node.child[1]) + 1);
+    }
+
+    void Grow(uint32_t capacity) {
+        if (capacity <= this->capacity) {
+            return;
+        }
+        void *nodes = realloc(this->nodes, (size_t) capacity * sizeof(AVL::CompactNode<Key, Value>));
+        if (!nodes) {
+            throw std::bad_alloc();
+        }
+        this->nodes = (AVL::CompactNode<Key, Value> *) nodes;
+        this->capacity = capacity;
+    }
+
+    uint32_t Allocate(const Key &key, const Value &value) {
+        uint32_t index = this->free_list;
+        if (index) {
+            this->free_list = this->nodes[index].child[0];
+        } else {
+            if (this->used == this->capacity) {
+                this->Grow(this->capacity * 2);
+            }
+            index = this->used++;
+        }
+        AVL::CompactNode<Key, Value> &node = this->nodes[index];
+        node.key = key;
+        node.value = value;
+        node.child[0] = 0;
+        node.child[1] = 0;
+        node.size_balance = 1u | (1u << BALANCE_SHIFT);
+        return index;
+    }
+
+    void Free(uint32_t index) {
+        this->nodes[index].child[0] = this->free_list;
+        this->free_list = index;
+    }
+
+    /*
+     * Restores a node whose balance factor reached +-2 (never stored, it does not fit in 2 bits).
+     * Sets unchanged if the subtree kept its height (only possible after a removal).
+     */
+    uint32_t Rebalance(uint32_t index, int balance, bool &unchanged) {
+        const uint32_t side = (balance > 0);
+        const int sign = (side ? 1 : -1);
+        const uint32_t child = this->nodes[index].child[side];
+        const int child_balance = this->GetBalance(child);
+        unchanged = false;
+        if (child_balance != -sign) {
+            // Single rotation: the heavy child becomes the subtree root.
+            this->nodes[index].child[side] = this->nodes[child].child[!side];
+            this->nodes[child].child[!side] = index;
+            if (child_balance == 0) {
+                unchanged = true;
+                this->SetBalance(index, sign);
+                this->SetBalance(child, -sign);
+            } else {
+                this->SetBalance(index, 0);
+                this->SetBalance(child, 0);
+            }
+            this->UpdateSize(index);
+            this->UpdateSize(child);
+            return child;
+        }
+        // Double rotation: the inner grandchild becomes the subtree root.
+        const uint32_t grandchild = this->nodes[child].child[!side];
+        const int grandchild_balance = this->GetBalance(grandchild);
+        this->nodes[child].child[!side] = this->nodes[grandchild].child[side];
+        this->nodes[index].child[side] = this->nodes[grandchild].child[!side];
+        this->nodes[grandchild].child[side] = child;
+        this->nodes[grandchild].child[!side] = index;
+        this->SetBalance(index, grandchild_balance == sign ? -sign : 0);
+        this->SetBalance(child, grandchild_balance == -sign ? sign : 0);
+        this->SetBalance(grandchild, 0);
+        this->UpdateSize(index);
+        this->UpdateSize(child);
+        this->UpdateSize(grandchild);
+        return grandchild;
+    }
+
+    uint32_t InsertTraverse(uint32_t index, uint32_t new_index, bool &grew) {
+        if (!index) {
+            grew = true;
+            return new_index;
+        }
+        const uint32_t direction = !(this->nodes[new_index].key < this->nodes[index].key);
+        const uint32_t child = this->InsertTraverse(this->nodes[index].child[direction], new_index, grew);
+        this->nodes[index].child[direction] = child;
+        this->UpdateSize(index);
+        if (!grew) {
+            return index;
+        }
+        const int balance = this->GetBalance(index) + (direction ? 1 : -1);
+        if (balance == 0 || balance == 1 || balance == -1) {
+            this->SetBalance(index, balance);
+            grew = (balance != 0);
+            return index;
+        }
+        grew = false;
+        bool unchanged;
+        return this->Rebalance(index, balance, unchanged);
+    }
+
+    /* Applies a height decrease of one child subtree, sets shrank if the subtree height decreased. */
+    uint32_t ChildShrank(uint32_t index, uint32_t direction, bool &shrank) {
+        const int balance = this->GetBalance(index) + (direction ? -1 : 1);
+        if (balance == 0 || balance == 1 || balance == -1) {
+            this->SetBalance(index, balance);
+            shrank = (balance == 0);
+            return index;
+        }
+        bool unchanged;
+        index = this->Rebalance(index, balance, unchanged);
+        shrank = !unchanged;
+        return index;
+    }
+
+    uint32_t RemoveMinTraverse(uint32_t index, uint32_t &min, bool &shrank) {
+        if (!this->nodes[index].child[0]) {
+            min = index;
+            shrank = true;
+            return this->nodes[index].child[1];
+        }
+        this->nodes[index].child[0] = this->RemoveMinTraverse(this->nodes[index].child[0], min, shrank);
+        this->UpdateSize(index);
+        if (!shrank) {
+            return index;
+        }
+        return this->ChildShrank(index, 0, shrank);
+    }
+
+    uint32_t RemoveTraverse(uint32_t index, const Key &key, bool &removed, bool &shrank) {
+        if (!index) {
+            shrank = false;
+            return 0;
+        }
+        uint32_t direction;
+        if (key < this->nodes[index].key) {
+            direction = 0;
+        } else if (this->nodes[index].key < key) {
+            direction = 1;
+        } else {
+            removed = true;
+            const uint32_t left = this->nodes[index].child[0];
+            const uint32_t right = this->nodes[index].child[1];
+            if (!left || !right) {
+                this->Free(index);
+                shrank = true;
+                return left ? left : right;
+            }
+            uint32_t successor = 0;
+            const uint32_t new_right = this->RemoveMinTraverse(right, successor, shrank);
+            this->nodes[successor].child[0] = left;
+            this->nodes[successor].child[1] = new_right;
+            this->nodes[successor].size_balance = this->nodes[index].size_balance;
+            this->UpdateSize(successor);
+            this->Free(index);
+            if (!shrank) {
+                return successor;
+            }
+            return this->ChildShrank(successor, 1, shrank);
+        }
+        this->nodes[index].child[direction] = this->RemoveTraverse(this->nodes[index].child[direction], key,
+                                                                   removed, shrank);
+        this->UpdateSize(index);
+        if (!shrank) {
+            return index;
+        }
+        return this->ChildShrank(index, direction, shrank);
+    }
+
+    /* Index of the first node whose key is not less than a given key, 0 if none. */
+    uint32_t LowerBound(const Key &key) const {
+        uint32_t candidate = 0;
+        uint32_t index = this->root;
+        while (index) {
+            const AVL::CompactNode<Key, Value> &node = this->nodes[index];
+            const bool less = (node.key < key);
+            candidate = (less ? candidate : index);
+            index = node.child[less];
+        }
+        return candidate;
+    }
+
+public:
+    /**
+     * Constructor: Constructs an empty compact tree.
+     * @note Worst-Time Complexity: O(1).
+     * @param capacity - Initial amount of preallocated nodes.
+     */
+    explicit CompactAVLTree(Number capacity = 16) :
+            nodes(NULL),
+            capacity(0),
+            used(1),
+            free_list(0),
+            root(0) {
+        this->Grow((uint32_t) std::max(capacity + 1, (Number) 2));
+        // Index 0 is the empty subtree, its size is always 0.
+        this->nodes[0].child[0] = 0;
+        this->nodes[0].child[1] = 0;
+        this->nodes[0].size_balance = (1u << BALANCE_SHIFT);
+    }
+
+    CompactAVLTree(const CompactAVLTree &tree) = delete;
+
+    CompactAVLTree &operator=(const CompactAVLTree &tree) = delete;
+
+    /**
+     * Destructor: Deallocates the entire class.
+     * @note Worst-Time Complexity: O(1).
+     */
+    ~CompactAVLTree() {
+        free(this->nodes);
+    }
+
+    /**
+     * Preallocates nodes for an expected amount of elements.
+     * @note Worst-Time Complexity: O(n).
+     * @param capacity - Expected amount of elements.
+     */
+    void Reserve(Number capacity) {
+        this->Grow((uint32_t) (capacity + 1));
+    }
+
+    /**
+     * Gets the tree size.
+     * @note Worst-Time Complexity: O(1).
+     * @return {Number} Tree size.
+     */
+    Number GetSize() const {
+        return this->Size(this->root);
+    }
+
+    /**
+     * Gets the amount of memory held by the node array.
+     * @note Worst-Time Complexity: O(1).
+     * @return {Number} Size in bytes.
+     */
+    Number GetMemoryUsage() const {
+        return (Number) this->capacity * (Number) sizeof(AVL::CompactNode<Key, Value>);
+    }
+
+    /**
+     * Find an element by its key.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param key - The element key.
+     * @param value - Receives the element value.
+     * @return {bool} True if found o.w False.
+     */
+    bool Find(const Key &key, Value &value) const {
+        const uint32_t index = this->LowerBound(key);
+        if (!index || key < this->nodes[index].key) {
+            return false;
+        }
+        value = this->nodes[index].value;
+        return true;
+    }
+
+    /**
+     * Insert new element to the tree.
+     * @note Worst-Time Complexity: O(log(n)), amortized when the node array grows.
+     * @param key - The element key.
+     * @param value - The element value.
+     */
+    void Insert(const Key key, const Value value) {
+        if (this->GetSize() == SIZE_MASK) {
+            throw std::length_error("CompactAVLTree is full.");
+        }
+        bool grew = false;
+        const uint32_t index = this->Allocate(key, value);
+        this->root = this->InsertTraverse(this->root, index, grew);
+    }
+
+    /**
+     * Removes an element from the tree.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param key - The element key.
+     * @return {bool} True if removed o.w False.
+     */
+    bool Remove(const Key key) {
+        bool removed = false;
+        bool shrank = false;
+        this->root = this->RemoveTraverse(this->root, key, removed, shrank);
+        return removed;
+    }
+
+    /**
+     * Gets the index of a specific element by key.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param key - The element key.
+     * @return {Number} Index of the first element with the key as if it was in a sorted array, -1 if not found.
+     */
+    Number GetIndexOfKey(const Key &key) const {
+        Number index = 0;
+        uint32_t candidate = 0;
+        Number candidate_index = 0;
+        uint32_t node = this->root;
+        while (node) {
+            const bool less = (this->nodes[node].key < key);
+            if (!less) {
+                candidate = node;
+                candidate_index = index + this->Size(this->nodes[node].child[0]);
+            } else {
+                index += this->Size(this->nodes[node].child[0]) + 1;
+            }
+            node = this->nodes[node].child[less];
+        }
+        if (!candidate || key < this->nodes[candidate].key) {
+            return -1;
+        }
+        return candidate_index;
+    }
+
+    /**
+     * Find an element by its index.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param index - The element index as if it was in a sorted array.
+     * @param key - Receives the element key.
+     * @param value - Receives the element value.
+     * @return {bool} True if the index is within range o.w False.
+     */
+    bool FindIndex(Number index, Key &key, Value &value) const {
+        if (index < 0 || index >= this->GetSize()) {
+            return false;
+        }
+        uint32_t node = this->root;
+        while (true) {
+            const Number left_size = this->Size(this->nodes[node].child[0]);
+            if (index == left_size) {
+                key = this->nodes[node].key;
+                value = this->nodes[node].value;
+                return true;
+            }
+            const bool right = (index > left_size);
+            index -= (right ? left_size + 1 : 0);
+            node = this->nodes[node].child[right];
+        }
+    }
+};
+
+#endif
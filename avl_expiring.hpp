@@ -0,0 +1,344 @@
+/**
+ * Expiring rank map built on the bidirectional rank map.
+ *
+ * @file avl_expiring.hpp
+ *
+ * @brief Ranked cache whose entries may carry an expiry timestamp and are swept incrementally.
+ *
+ * @author Liav Barsheshet
+ * Contact: liavbarsheshet@gmail.com
+ *
+ * This implementation is free: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This implementation is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include "avl_bimap.hpp"
+
+#ifndef _AVL_EXPIRING_HPP
+#define _AVL_EXPIRING_HPP
+
+namespace AVL {
+    template<typename Value, typename Timestamp>
+    class ExpiringValue;
+
+    template<typename Value, typename Timestamp>
+    class ExpiryCompare;
+
+    template<typename Key, typename Value,
+            typename Timestamp = long long,
+            typename Number = long long,
+            class Compare = CompareFunc<Key>>
+    class ExpiringRankTree;
+}
+
+/**
+ * Class: Value of an expiring entry together with its expiry timestamp.
+ * @tparam Value - The type/class of the value.
+ * @tparam Timestamp - The type/class of the expiry timestamp.
+ */
+template<typename Value, typename Timestamp>
+class AVL::ExpiringValue {
+public:
+    Value value;
+    Timestamp expiry;
+
+    ExpiringValue(Value value, Timestamp expiry) :
+            value(value),
+            expiry(expiry) {}
+};
+
+/**
+ * Class: Orders expiring values by their expiry timestamp.
+ * @tparam Value - The type/class of the value.
+ * @tparam Timestamp - The type/class of the expiry timestamp.
+ */
+template<typename Value, typename Timestamp>
+class AVL::ExpiryCompare {
+public:
+    AVL::COMPARE_RESULT operator()(const AVL::ExpiringValue<Value, Timestamp> &value1,
+                                   const AVL::ExpiringValue<Value, Timestamp> &value2) const {
+        if (value1.expiry < value2.expiry) {
+            return LESS_THAN;
+        }
+        if (value2.expiry < value1.expiry) {
+            return GREATER_THAN;
+        }
+        return EQUAL;
+    }
+};
+
+/**
+ * Class: Expiring Rank Tree.
+ * Ranked map (by key) whose entries may expire. Every entry is also linked in a second AVL tree ordered by its
+ * expiry timestamp, so the next entries to expire are found without a scan and ExpireUpTo sweeps a bounded
+ * amount of them per call. An entry is expired at `now` if its expiry <= now; entries inserted without an
+ * expiry never expire.
+ * Rank queries taking `now` exclude expired entries that were not swept yet, at an extra O(e) (GetIndexOfKey)
+ * or O(e*log(n)) (FindIndex) where e is the amount of such entries (kept small by sweeping regularly).
+ * @tparam Key - The type/class of the key.
+ * @tparam Value - The type/class of the value.
+ * @tparam Timestamp - The type/class of the expiry timestamp.
+ * @tparam Number - Class/Primitive for numbers representation.
+ * @tparam Compare - Compare Function Object of the keys.
+ */
+template<typename Key, typename Value, typename Timestamp, typename Number, class Compare>
+class AVL::ExpiringRankTree : protected AVL::BiRankMap<Key, AVL::ExpiringValue<Value, Timestamp>, Number,
+        AVL::DefaultRank<Key, AVL::ExpiringValue<Value, Timestamp>, Number>,
+        AVL::DefaultRank<Key, AVL::ExpiringValue<Value, Timestamp>, Number>, Compare,
+        AVL::ExpiryCompare<Value, Timestamp>> {
+    typedef AVL::ExpiringValue<Value, Timestamp> Expiring;
+    typedef AVL::DefaultRank<Key, Expiring, Number> Rank;
+    typedef AVL::BiRankMap<Key, Expiring, Number, Rank, Rank, Compare, AVL::ExpiryCompare<Value, Timestamp>> Map;
+    typedef typename Map::Entry Entry;
+    typedef typename Map::ValueNode ValueNode;
+
+    static bool IsExpired(const Entry *entry, const Timestamp &now) {
+        return !(now < entry->value.value.expiry);
+    }
+
+    /* Key index positions of the expired entries, sorted. */
+    std::vector<Number> ExpiredPositions(const Timestamp &now) const {
+        std::vector<Number> positions;
+        for (ValueNode *node = this->values.First();
+             node && IsExpired(node->key, now); node = this->values.Next(node)) {
+            positions.push_back(this->GetIndexOfNode(node->key));
+        }
+        std::sort(positions.begin(), positions.end());
+        return positions;
+    }
+
+public:
+    /**
+     * Timestamp of entries that never expire.
+     */
+    static Timestamp Never() {
+        return std::numeric_limits<Timestamp>::max();
+    }
+
+    /**
+     * Constructor: Constructs an empty expiring rank tree.
+     * @note Worst-Time Complexity: O(1).
+     */
+    ExpiringRankTree() :
+            Map() {}
+
+    ExpiringRankTree(const ExpiringRankTree &tree) = delete;
+
+    ExpiringRankTree &operator=(const ExpiringRankTree &tree) = delete;
+
+    /**
+     * Inserts a new entry.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param key - The entry key.
+     * @param value - The entry value.
+     * @param expiry - The entry expiry timestamp (Default: Never).
+     * @return {bool} True if inserted, False if the key already exists.
+     */
+    bool Insert(const Key key, const Value value, const Timestamp expiry = Never()) {
+        return Map::Insert(key, Expiring(value, expiry));
+    }
+
+    /**
+     * Changes the expiry timestamp of an entry.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param key - The entry key.
+     * @param expiry - The new expiry timestamp (Never() removes the expiry).
+     * @return {bool} True if the entry was found o.w False.
+     */
+    bool SetExpiry(const Key key, const Timestamp expiry) {
+        Entry *entry = this->FindNode(key);
+        if (!entry) {
+            return false;
+        }
+        this->AssignValue(entry, Expiring(entry->value.value.value, expiry));
+        return true;
+    }
+
+    /**
+     * Removes an entry.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param key - The entry key.
+     * @return {bool} True if removed o.w False.
+     */
+    bool Remove(const Key key) {
+        return Map::Remove(key);
+    }
+
+    /**
+     * Removes up to `budget` expired entries, the earliest to expire first.
+     * @note Worst-Time Complexity: O(budget*log(n)).
+     * @param now - The current timestamp.
+     * @param budget - Maximal amount of entries to remove in this call.
+     * @return {Number} Amount of removed entries.
+     */
+    Number ExpireUpTo(const Timestamp now, Number budget) {
+        Number removed = 0;
+        while (removed < budget) {
+            ValueNode *node = this->values.First();
+            if (!node || !IsExpired(node->key, now)) {
+                break;
+            }
+            this->RemoveEntry(node->key);
+            ++removed;
+        }
+        return removed;
+    }
+
+    /**
+     * Gets the earliest expiry timestamp among the entries.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @return {Timestamp} Earliest expiry, Never() if no entry expires.
+     */
+    Timestamp GetNextExpiry() const {
+        const ValueNode *node = this->values.First();
+        return node ? node->key->value.value.expiry : Never();
+    }
+
+    /**
+     * Counts the expired entries that were not swept yet.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param now - The current timestamp.
+     * @return {Number} Amount of entries with expiry <= now.
+     */
+    Number GetExpiredCount(const Timestamp now) const {
+        return this->CountValuesWhile([&now](const Expiring &value) {
+            return !(now < value.expiry);
+        });
+    }
+
+    /**
+     * Gets the amount of entries, including expired entries that were not swept yet.
+     * @note Worst-Time Complexity: O(1).
+     * @return {Number} Amount of entries.
+     */
+    Number GetSize() const {
+        return this->size;
+    }
+
+    /**
+     * Gets the amount of live entries.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param now - The current timestamp.
+     * @return {Number} Amount of entries that are not expired.
+     */
+    Number GetSize(const Timestamp now) const {
+        return this->size - this->GetExpiredCount(now);
+    }
+
+    /**
+     * Find an entry by its key.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param key - The entry key.
+     * @param value - Receives the entry value.
+     * @return {bool} True if found o.w False.
+     */
+    bool Find(const Key key, Value &value) const {
+        const Entry *entry = this->FindNode(key);
+        if (!entry) {
+            return false;
+        }
+        value = entry->value.value.value;
+        return true;
+    }
+
+    /**
+     * Find a live entry by its key.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param key - The entry key.
+     * @param value - Receives the entry value.
+     * @param now - The current timestamp.
+     * @return {bool} True if found and not expired o.w False.
+     */
+    bool Find(const Key key, Value &value, const Timestamp now) const {
+        const Entry *entry = this->FindNode(key);
+        if (!entry || IsExpired(entry, now)) {
+            return false;
+        }
+        value = entry->value.value.value;
+        return true;
+    }
+
+    /**
+     * Gets the index of an entry by its key, counting expired entries that were not swept yet.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param key - The entry key.
+     * @return {Number} Index of the entry as if the tree was a sorted array, -1 if not found.
+     */
+    Number GetIndexOfKey(const Key key) const {
+        return Map::GetIndexOfKey(key);
+    }
+
+    /**
+     * Gets the index of a live entry by its key among the live entries.
+     * @note Worst-Time Complexity: O(log(n) + e) - e=expired entries not swept yet (walked in expiry order, one
+     * key comparison each, no allocation).
+     * @param key - The entry key.
+     * @param now - The current timestamp.
+     * @return {Number} Index of the entry as if the live entries were a sorted array, -1 if not found or expired.
+     */
+    Number GetIndexOfKey(const Key key, const Timestamp now) const {
+        const Entry *entry = this->FindNode(key);
+        if (!entry || IsExpired(entry, now)) {
+            return -1;
+        }
+        Number position = this->GetIndexOfNode(entry);
+        for (ValueNode *node = this->values.First();
+             node && IsExpired(node->key, now); node = this->values.Next(node)) {
+            if (this->CompareKeys(node->key->key, key) == LESS_THAN) {
+                --position;
+            }
+        }
+        return position;
+    }
+
+    /**
+     * Find an entry by its index, counting expired entries that were not swept yet.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param index - The entry index as if the tree was a sorted array.
+     * @param key - Receives the entry key.
+     * @param value - Receives the entry value.
+     * @return {bool} True if the index is in range o.w False.
+     */
+    bool FindIndex(const Number index, Key &key, Value &value) const {
+        const Entry *entry = this->FindIndexNode(index);
+        if (!entry) {
+            return false;
+        }
+        key = entry->key;
+        value = entry->value.value.value;
+        return true;
+    }
+
+    /**
+     * Find a live entry by its index among the live entries.
+     * @note Worst-Time Complexity: O(log(n) + e*log(n)) - e=expired entries not swept yet.
+     * @param index - The entry index as if the live entries were a sorted array.
+     * @param key - Receives the entry key.
+     * @param value - Receives the entry value.
+     * @param now - The current timestamp.
+     * @return {bool} True if the index is in range o.w False.
+     */
+    bool FindIndex(const Number index, Key &key, Value &value, const Timestamp now) const {
+        if (index < 0) {
+            return false;
+        }
+        const std::vector<Number> expired = this->ExpiredPositions(now);
+        Number position = index;
+        for (size_t i = 0; i < expired.size() && expired[i] <= position; ++i) {
+            ++position;
+        }
+        return this->FindIndex(position, key, value);
+    }
+};
+
+#endif
@@ -0,0 +1,366 @@
+/**
+ * Interval tree built on top of the Generic AVL (Balanced) Rank Tree.
+ *
+ * @file avl_interval.hpp
+ *
+ * @brief Closed intervals ordered by their low end point, augmented with the subtree max high end point.
+ *
+ * @author Liav Barsheshet
+ * Contact: liavbarsheshet@gmail.com
+ *
+ * This implementation is free: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This implementation is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+#include "avl.hpp"
+
+#ifndef _AVL_INTERVAL_HPP
+#define _AVL_INTERVAL_HPP
+
+namespace AVL {
+    template<typename T>
+    class Interval;
+
+    template<typename T, typename Value, typename Number = long long>
+    class IntervalRank;
+
+    template<typename T, typename Value, typename Number = long long>
+    class IntervalRankTree;
+}
+
+/**
+ * Class: Represents a closed interval [low, high].
+ * @tparam T - The type/class of the end points.
+ */
+template<typename T>
+class AVL::Interval {
+public:
+    T low;
+    T high;
+
+    Interval() = default;
+
+    Interval(T low, T high) :
+            low(low),
+            high(high) {}
+
+    bool operator<(const Interval<T> &interval) const {
+        return (this->low < interval.low) || (!(interval.low < this->low) && this->high < interval.high);
+    }
+
+    bool operator>(const Interval<T> &interval) const {
+        return interval < (*this);
+    }
+
+    std::ostream &Print(std::ostream &os) const {
+        os << "[" << this->low << ", " << this->high << "]";
+        return os;
+    }
+};
+
+template<typename T>
+std::ostream &operator<<(std::ostream &os, const AVL::Interval<T> &interval) {
+    interval.Print(os);
+    return os;
+}
+
+/**
+ * Class: Rank information of an interval tree.
+ * Counts the elements and keeps the max high end point of the subtree.
+ * @note The max high end point is not invertible, operator-= only updates the count.
+ * @tparam T - The type/class of the end points.
+ * @tparam Value - The type/class of the value.
+ * @tparam Number - Class/Primitive for numbers representation.
+ */
+template<typename T, typename Value, typename Number>
+class AVL::IntervalRank {
+public:
+    Number rank;
+    T max_high;
+
+    IntervalRank() :
+            rank(0),
+            max_high() {}
+
+    IntervalRank(AVL::Interval<T> key, Value value) :
+            rank(1),
+            max_high(key.high) {
+        (void) value;
+    }
+
+    IntervalRank(const IntervalRank<T, Value, Number> &_rank) :
+            rank(_rank.rank),
+            max_high(_rank.max_high) {}
+
+    ~IntervalRank() {}
+
+    AVL::IntervalRank<T, Value, Number> &operator=(const IntervalRank<T, Value, Number> &_rank) {
+        this->rank = _rank.rank;
+        this->max_high = _rank.max_high;
+        return (*this);
+    }
+
+    AVL::IntervalRank<T, Value, Number> &operator-=(const IntervalRank<T, Value, Number> &_rank) {
+        this->rank -= _rank.rank;
+        return (*this);
+    }
+
+    AVL::IntervalRank<T, Value, Number> &operator+=(const IntervalRank<T, Value, Number> &_rank) {
+        if (_rank.rank == 0) {
+            return (*this);
+        }
+        if (this->rank == 0 || this->max_high < _rank.max_high) {
+            this->max_high = _rank.max_high;
+        }
+        this->rank += _rank.rank;
+        return (*this);
+    }
+
+    std::ostream &Print(std::ostream &os) const {
+        os << "{" << this->rank << ", " << this->max_high << "}";
+        return os;
+    }
+};
+
+/**
+ * Class: Interval Rank Tree.
+ * AVL rank tree of closed intervals (ordered by low, then high) whose nodes maintain the max high
+ * end point of their subtree through the rank information, so overlap queries prune whole subtrees.
+ * A second rank tree of the high end points makes overlap counting O(log(n)).
+ * @note The base tree is protected, so every modification goes through this class and keeps the high end points
+ * in sync; only the read interface is re-exported. The approximate rank mode is not available (counts are exact).
+ * @tparam T - The type/class of the end points.
+ * @tparam Value - The type/class of the value.
+ * @tparam Number - Class/Primitive for numbers representation.
+ */
+template<typename T, typename Value, typename Number>
+class AVL::IntervalRankTree : protected AVL::AVLRankTree<AVL::Interval<T>, Value, Number,
+        AVL::IntervalRank<T, Value, Number>, AVL::CompareFunc<AVL::Interval<T>>> {
+    typedef AVL::IntervalRank<T, Value, Number> TreeRank;
+    typedef AVL::AVLRankTree<AVL::Interval<T>, Value, Number, TreeRank, AVL::CompareFunc<AVL::Interval<T>>> Tree;
+    typedef AVL::Node<AVL::Interval<T>, Value, TreeRank, Number> TreeNode;
+
+    AVL::AVLRankTree<T, bool, Number> high_points;
+
+    template<typename Visitor>
+    void OverlapTraverse(TreeNode *node, const T &low, const T &high, Visitor &visitor) const {
+        if (!node || node->rank->max_high < low) {
+            return;
+        }
+        this->OverlapTraverse(node->left_child, low, high, visitor);
+        if (high < node->key.low) {
+            return;
+        }
+        if (!(node->key.high < low)) {
+            visitor(node->key, node->value);
+        }
+        this->OverlapTraverse(node->right_child, low, high, visitor);
+    }
+
+    /* Reads the subtree counts directly, they are exact since the approximate rank mode is not exposed. */
+    Number CountLowNotGreaterThan(const T &point) const {
+        TreeNode *node = this->root;
+        Number count = 0;
+        while (node) {
+            if (point < node->key.low) {
+                node = node->left_child;
+            } else {
+                count += (node->left_child ? node->left_child->rank->rank : 0) + 1;
+                node = node->right_child;
+            }
+        }
+        return count;
+    }
+
+public:
+    using Tree::GetSize;
+    using Tree::GetHeight;
+    using Tree::GetIndexOfKey;
+    using Tree::CountLessThan;
+    using Tree::CountLessOrEqual;
+    using Tree::Find;
+    using Tree::FindNode;
+    using Tree::FindIndex;
+    using Tree::FindIndexNode;
+    using Tree::GetIndexOfNode;
+    using Tree::Next;
+    using Tree::Prev;
+    using Tree::GetMin;
+    using Tree::GetMax;
+    using Tree::Closest;
+    using Tree::Update;
+    using Tree::CollectRank;
+    using Tree::Query;
+    using Tree::ParallelQuery;
+    using Tree::PartitionPoints;
+    using Tree::CollectRankBatch;
+    using Tree::QueryMultiRange;
+    using Tree::Validate;
+    using Tree::PrintTree;
+    using Tree::operator[];
+
+    /**
+     * Constructor: Constructs an empty interval rank tree.
+     * @note Worst-Time Complexity: O(1).
+     */
+    IntervalRankTree() :
+            Tree(),
+            high_points() {}
+
+    /**
+     * Insert new interval to the tree.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param key - The interval.
+     * @param value - The element value.
+     */
+    void Insert(const AVL::Interval<T> key, const Value value) {
+        this->InsertNode(key, value);
+    }
+
+    /**
+     * Inserts a new interval or assigns the value of an existing equal interval.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param key - The interval.
+     * @param value - The element value.
+     * @return {bool} True if a new interval was inserted, False if an existing one was assigned.
+     */
+    bool InsertOrAssign(const AVL::Interval<T> key, const Value value) {
+        TreeNode *node = this->FindNode(key);
+        if (node) {
+            node->value = value;
+            this->UpdateRankUpwards(node);
+            return false;
+        }
+        this->InsertNode(key, value);
+        return true;
+    }
+
+    /**
+     * Insert new interval to the tree and returns its node.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param key - The interval.
+     * @param value - The element value.
+     * @return {Node<Interval<T>, Value, IntervalRank<T, Value, Number>, Number>} the node of the new element.
+     */
+    TreeNode *InsertNode(const AVL::Interval<T> key, const Value value) {
+        this->high_points.Insert(key.high, true);
+        return Tree::InsertNode(key, value);
+    }
+
+    /**
+     * Removes an interval from the tree.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param key - The interval.
+     * @return {bool} True if removed o.w False.
+     */
+    bool Remove(const AVL::Interval<T> key) {
+        TreeNode *node = this->FindNode(key);
+        if (!node) {
+            return false;
+        }
+        this->RemoveNode(node);
+        return true;
+    }
+
+    /**
+     * Removes an interval by its node without searching for it.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param node - A node of this tree, deallocated by this call.
+     */
+    void RemoveNode(TreeNode *node) {
+        this->high_points.Remove(node->key.high);
+        Tree::RemoveNode(node);
+    }
+
+    /**
+     * Changes an interval, relocating its node without reallocating it.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param old_key - The current interval.
+     * @param new_key - The new interval.
+     * @return {bool} True if the interval was found o.w False.
+     */
+    bool ChangeKey(const AVL::Interval<T> old_key, const AVL::Interval<T> new_key) {
+        TreeNode *node = this->FindNode(old_key);
+        if (!node) {
+            return false;
+        }
+        this->ChangeNodeKey(node, new_key);
+        return true;
+    }
+
+    /**
+     * Changes an interval by its node, relocating the node without reallocating it.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param node - A node of this tree.
+     * @param new_key - The new interval.
+     */
+    void ChangeNodeKey(TreeNode *node, const AVL::Interval<T> new_key) {
+        this->high_points.ChangeKey(node->key.high, new_key.high);
+        Tree::ChangeNodeKey(node, new_key);
+    }
+
+    /**
+     * Visits every interval overlapping a given closed interval (in order of the low end point).
+     * Subtrees whose max high end point is below the query are pruned, so each reported interval costs a path.
+     * @note Worst-Time Complexity: O(min(n, (k + 1)*log(n))) - k=overlapping intervals.
+     * @note An inverted query (high < low) is empty and overlaps nothing.
+     * @tparam Visitor - Callable object with the signature void(const Interval<T> &, Value &).
+     * @param low - The query low end point.
+     * @param high - The query high end point.
+     * @param visitor - Called for each overlapping interval.
+     */
+    template<typename Visitor>
+    void QueryOverlapping(const T &low, const T &high, Visitor visitor) const {
+        if (high < low) {
+            return;
+        }
+        this->OverlapTraverse(this->root, low, high, visitor);
+    }
+
+    /**
+     * Visits every interval containing a given point (in order of the low end point).
+     * @note Worst-Time Complexity: O(min(n, (k + 1)*log(n))) - k=overlapping intervals.
+     * @tparam Visitor - Callable object with the signature void(const Interval<T> &, Value &).
+     * @param point - The query point.
+     * @param visitor - Called for each overlapping interval.
+     */
+    template<typename Visitor>
+    void QueryOverlapping(const T &point, Visitor visitor) const {
+        this->OverlapTraverse(this->root, point, point, visitor);
+    }
+
+    /**
+     * Counts the intervals overlapping a given closed interval.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @note An inverted query (high < low) is empty and overlaps nothing.
+     * @param low - The query low end point.
+     * @param high - The query high end point.
+     * @return {Number} Amount of overlapping intervals.
+     */
+    Number CountOverlapping(const T &low, const T &high) const {
+        if (high < low) {
+            return 0;
+        }
+        // Every interval with high < low also has its low end point <= high.
+        return this->CountLowNotGreaterThan(high) - this->high_points.CountLessThan(low);
+    }
+
+    /**
+     * Counts the intervals containing a given point.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param point - The query point.
+     * @return {Number} Amount of overlapping intervals.
+     */
+    Number CountOverlapping(const T &point) const {
+        return this->CountOverlapping(point, point);
+    }
+};
+
+#endif
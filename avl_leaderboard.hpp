@@ -0,0 +1,309 @@
+/**
+ * Leaderboard built on top of the Generic AVL (Balanced) Rank Tree.
+ *
+ * @file avl_leaderboard.hpp
+ *
+ * @brief Player id to score mapping ranked by score (ties broken by id).
+ *
+ * @author Liav Barsheshet
+ * Contact: liavbarsheshet@gmail.com
+ *
+ * This implementation is free: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This implementation is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+#include <functional>
+#include <unordered_map>
+#include "avl.hpp"
+
+#ifndef _AVL_LEADERBOARD_HPP
+#define _AVL_LEADERBOARD_HPP
+
+namespace AVL {
+    template<typename Id, typename Score>
+    class LeaderboardKey;
+
+    template<typename Id, typename Score>
+    class LeaderboardCompare;
+
+    template<typename Id, typename Score, typename Number = long long>
+    class LeaderboardEntry;
+
+    template<typename Id, typename Score,
+            typename Number = long long,
+            class Hash = std::hash<Id>>
+    class Leaderboard;
+}
+
+/**
+ * Class: Represents a leaderboard tree key (score, id).
+ * @tparam Id - The type/class of the player id.
+ * @tparam Score - The type/class of the score.
+ */
+template<typename Id, typename Score>
+class AVL::LeaderboardKey {
+public:
+    Score score;
+    Id id;
+
+    LeaderboardKey() = default;
+
+    LeaderboardKey(Score score, Id id) :
+            score(score),
+            id(id) {}
+
+    bool operator<(const LeaderboardKey<Id, Score> &key) const {
+        return (this->score < key.score) || (!(key.score < this->score) && this->id < key.id);
+    }
+
+    bool operator>(const LeaderboardKey<Id, Score> &key) const {
+        return key < (*this);
+    }
+
+    std::ostream &Print(std::ostream &os) const {
+        os << "(" << this->score << ", " << this->id << ")";
+        return os;
+    }
+};
+
+template<typename Id, typename Score>
+std::ostream &operator<<(std::ostream &os, const AVL::LeaderboardKey<Id, Score> &key) {
+    key.Print(os);
+    return os;
+}
+
+/**
+ * Class: Leaderboard Compare Function.
+ * Orders keys by score (highest first), equal scores are ordered by id (lowest first).
+ * @tparam Id - The type/class of the player id.
+ * @tparam Score - The type/class of the score.
+ */
+template<typename Id, typename Score>
+class AVL::LeaderboardCompare : public AVL::CompareFunc<AVL::LeaderboardKey<Id, Score>> {
+public:
+    AVL::COMPARE_RESULT operator()(const AVL::LeaderboardKey<Id, Score> key1,
+                                   const AVL::LeaderboardKey<Id, Score> key2) const {
+        if (key2.score < key1.score) {
+            return LESS_THAN;
+        }
+        if (key1.score < key2.score) {
+            return GREATER_THAN;
+        }
+        if (key1.id < key2.id) {
+            return LESS_THAN;
+        }
+        if (key2.id < key1.id) {
+            return GREATER_THAN;
+        }
+        return EQUAL;
+    }
+};
+
+/**
+ * Class: Represents a single leaderboard row.
+ * @tparam Id - The type/class of the player id.
+ * @tparam Score - The type/class of the score.
+ * @tparam Number - Class/Primitive for numbers representation.
+ */
+template<typename Id, typename Score, typename Number>
+class AVL::LeaderboardEntry {
+public:
+    Id id;
+    Score score;
+    /* Zero based position on the leaderboard. */
+    Number rank;
+
+    LeaderboardEntry() = default;
+
+    LeaderboardEntry(Id id, Score score, Number rank) :
+            id(id),
+            score(score),
+            rank(rank) {}
+
+    std::ostream &Print(std::ostream &os) const {
+        os << "#" << this->rank << " " << this->id << ": " << this->score;
+        return os;
+    }
+};
+
+template<typename Id, typename Score, typename Number>
+std::ostream &operator<<(std::ostream &os, const AVL::LeaderboardEntry<Id, Score, Number> &entry) {
+    entry.Print(os);
+    return os;
+}
+
+/**
+ * Class: Leaderboard.
+ * An AVL rank tree keyed by (score, id) paired with a hash index from id to tree node.
+ * Queries write into caller provided arrays, and score updates relocate the existing node,
+ * so neither allocates once a player is registered.
+ * @tparam Id - The type/class of the player id.
+ * @tparam Score - The type/class of the score.
+ * @tparam Number - Class/Primitive for numbers representation.
+ * @tparam Hash - Hash Function Object of the player id.
+ */
+template<typename Id, typename Score, typename Number, class Hash>
+class AVL::Leaderboard {
+    typedef AVL::LeaderboardKey<Id, Score> TreeKey;
+    typedef AVL::DefaultRank<TreeKey, bool, Number> TreeRank;
+    typedef AVL::AVLRankTree<TreeKey, bool, Number, TreeRank, AVL::LeaderboardCompare<Id, Score>> Tree;
+    typedef AVL::Node<TreeKey, bool, TreeRank, Number> TreeNode;
+
+    Tree tree;
+    std::unordered_map<Id, TreeNode *, Hash> index;
+
+    Number Collect(TreeNode *node, Number rank, Number count,
+                   AVL::LeaderboardEntry<Id, Score, Number> *result) const {
+        Number total = 0;
+        while (node && total < count) {
+            result[total] = AVL::LeaderboardEntry<Id, Score, Number>(node->key.id, node->key.score, rank + total);
+            node = this->tree.Next(node);
+            ++total;
+        }
+        return total;
+    }
+
+public:
+    /**
+     * Constructor: Constructs an empty leaderboard.
+     * @note Worst-Time Complexity: O(1).
+     */
+    Leaderboard() :
+            tree(),
+            index() {}
+
+    Leaderboard(const Leaderboard &leaderboard) = delete;
+
+    Leaderboard &operator=(const Leaderboard &leaderboard) = delete;
+
+    /**
+     * Reserves the id index for an expected amount of players.
+     * @note Worst-Time Complexity: O(n).
+     * @param players - Expected amount of players.
+     */
+    void Reserve(Number players) {
+        this->index.reserve(players);
+    }
+
+    /**
+     * Gets the amount of players.
+     * @note Worst-Time Complexity: O(1).
+     * @return {Number} Amount of players.
+     */
+    Number GetSize() const {
+        return this->tree.GetSize();
+    }
+
+    /**
+     * Sets the score of a player, registering the player if needed.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param id - The player id.
+     * @param score - The new player score.
+     */
+    void SetScore(const Id &id, const Score &score) {
+        typename std::unordered_map<Id, TreeNode *, Hash>::iterator it = this->index.find(id);
+        if (it == this->index.end()) {
+            this->index.insert(std::make_pair(id, this->tree.InsertNode(TreeKey(score, id), true)));
+            return;
+        }
+        this->tree.ChangeNodeKey(it->second, TreeKey(score, id));
+    }
+
+    /**
+     * Gets the score of a player.
+     * @note Worst-Time Complexity: O(1).
+     * @param id - The player id.
+     * @param score - Receives the player score.
+     * @return {bool} True if the player exists o.w False.
+     */
+    bool GetScore(const Id &id, Score &score) const {
+        typename std::unordered_map<Id, TreeNode *, Hash>::const_iterator it = this->index.find(id);
+        if (it == this->index.end()) {
+            return false;
+        }
+        score = it->second->key.score;
+        return true;
+    }
+
+    /**
+     * Removes a player from the leaderboard.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param id - The player id.
+     * @return {bool} True if removed o.w False.
+     */
+    bool Remove(const Id &id) {
+        typename std::unordered_map<Id, TreeNode *, Hash>::iterator it = this->index.find(id);
+        if (it == this->index.end()) {
+            return false;
+        }
+        this->tree.RemoveNode(it->second);
+        this->index.erase(it);
+        return true;
+    }
+
+    /**
+     * Gets the position of a player on the leaderboard.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param id - The player id.
+     * @return {Number} Zero based position or -1 if the player does not exist.
+     */
+    Number RankOf(const Id &id) const {
+        typename std::unordered_map<Id, TreeNode *, Hash>::const_iterator it = this->index.find(id);
+        if (it == this->index.end()) {
+            return -1;
+        }
+        return this->tree.GetIndexOfNode(it->second);
+    }
+
+    /**
+     * Collects the top players.
+     * @note Worst-Time Complexity: O(log(n) + k).
+     * @param k - Maximum amount of players.
+     * @param result - Caller provided array of at least k entries.
+     * @return {Number} Amount of entries written.
+     */
+    Number TopK(Number k, AVL::LeaderboardEntry<Id, Score, Number> *result) const {
+        return this->Page(0, k, result);
+    }
+
+    /**
+     * Collects the players ranked around a given player (k above and k below).
+     * @note Worst-Time Complexity: O(log(n) + k).
+     * @param id - The player id.
+     * @param k - Amount of players on each side.
+     * @param result - Caller provided array of at least 2k+1 entries.
+     * @return {Number} Amount of entries written (0 if the player does not exist).
+     */
+    Number AroundMe(const Id &id, Number k, AVL::LeaderboardEntry<Id, Score, Number> *result) const {
+        const Number rank = this->RankOf(id);
+        if (rank < 0) {
+            return 0;
+        }
+        const Number first = (rank > k ? rank - k : 0);
+        return this->Page(first, rank + k + 1 - first, result);
+    }
+
+    /**
+     * Collects a page of players by rank.
+     * @note Worst-Time Complexity: O(log(n) + count).
+     * @param first - Zero based rank of the first entry.
+     * @param count - Maximum amount of players.
+     * @param result - Caller provided array of at least count entries.
+     * @return {Number} Amount of entries written.
+     */
+    Number Page(Number first, Number count, AVL::LeaderboardEntry<Id, Score, Number> *result) const {
+        if (count <= 0) {
+            return 0;
+        }
+        return this->Collect(this->tree.FindIndexNode(first), first, count, result);
+    }
+};
+
+#endif
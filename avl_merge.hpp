@@ -0,0 +1,280 @@
+/**
+ * K-way merge iterator across Generic AVL (Balanced) Rank Trees.
+ *
+ * @file avl_merge.hpp
+ *
+ * @brief Lazily merges the same key range of several rank trees in sorted order, using a loser tree.
+ *
+ * @author Liav Barsheshet
+ * Contact: liavbarsheshet@gmail.com
+ *
+ * This implementation is free: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This implementation is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+#include <algorithm>
+#include <vector>
+#include "avl.hpp"
+
+#ifndef _AVL_MERGE_HPP
+#define _AVL_MERGE_HPP
+
+namespace AVL {
+    template<typename Key, typename Value,
+            typename Number = long long,
+            class RankInfo = DefaultRank<Key, Value, Number>,
+            class Compare = CompareFunc<Key>>
+    class MergeIterator;
+}
+
+/**
+ * Class: K-way Merge Iterator.
+ * Iterates the elements within the filter range of several trees as a single sorted sequence (equal keys are
+ * ordered by tree), without materializing any intermediate array. Each tree contributes a cursor walking its
+ * nodes in order, and a loser tree picks the next element in O(log(k)) comparisons.
+ * The offset is resolved up front by rank: a selection over the per-tree ranks finds where every cursor starts,
+ * so skipped elements are never visited.
+ * @note The trees must not be modified while iterating. The cursors are positioned by rank, trees in approximate
+ * rank mode must be flushed first (see AVLRankTree::FlushRanks).
+ * @note The offset counts elements within the range, the limit counts returned elements (after FilterFunction).
+ * @tparam Key - The type/class of the key.
+ * @tparam Value - The type/class of the value.
+ * @tparam Number - Class/Primitive for numbers representation.
+ * @tparam RankInfo - Class of rank information.
+ * @tparam Compare - Compare Function Object of the keys.
+ */
+template<typename Key, typename Value, typename Number, class RankInfo, class Compare>
+class AVL::MergeIterator {
+    typedef AVL::AVLRankTree<Key, Value, Number, RankInfo, Compare> Tree;
+    typedef AVL::Node<Key, Value, RankInfo, Number> TreeNode;
+
+    class Cursor {
+    public:
+        const Tree *tree;
+        TreeNode *node;
+        Number remaining;
+    };
+
+    std::vector<Cursor> cursors;
+    /* Loser tree over the cursors: losers[1..leaves) hold the loser of each match, winner the overall one. */
+    std::vector<size_t> losers;
+    size_t leaves;
+    size_t winner;
+    bool reverse;
+    Number limit;
+    bool (*filter_function)(Key, Value);
+    Compare compare;
+
+    /* Whether cursor a yields before cursor b (exhausted cursors yield last). */
+    bool Before(size_t a, size_t b) const {
+        if (a >= this->cursors.size() || this->cursors[a].remaining <= 0) {
+            return false;
+        }
+        if (b >= this->cursors.size() || this->cursors[b].remaining <= 0) {
+            return true;
+        }
+        const COMPARE_RESULT result = this->compare(this->cursors[a].node->key, this->cursors[b].node->key);
+        if (result == EQUAL) {
+            return this->reverse ? a > b : a < b;
+        }
+        return result == (this->reverse ? GREATER_THAN : LESS_THAN);
+    }
+
+    size_t Build(size_t position) {
+        if (position >= this->leaves) {
+            return position - this->leaves;
+        }
+        const size_t left = this->Build(2 * position);
+        const size_t right = this->Build(2 * position + 1);
+        if (this->Before(left, right)) {
+            this->losers[position] = right;
+            return left;
+        }
+        this->losers[position] = left;
+        return right;
+    }
+
+    /* Replays the matches on the path of the winner after it advanced. */
+    void Replay() {
+        size_t current = this->winner;
+        for (size_t position = (current + this->leaves) / 2; position > 0; position /= 2) {
+            if (this->Before(this->losers[position], current)) {
+                std::swap(this->losers[position], current);
+            }
+        }
+        this->winner = current;
+    }
+
+    /* Amount of elements of a tree ordered before (key, tree) in the merged ascending order. */
+    Number CountBefore(size_t index, const Key &key, size_t tree, Number low, Number high) const {
+        const Number count = (index < tree ? this->cursors[index].tree->CountLessOrEqual(key)
+                                           : this->cursors[index].tree->CountLessThan(key));
+        return std::min(std::max(count, low), high);
+    }
+
+    /**
+     * Finds for each tree how many of its range elements are among the `target` smallest merged elements.
+     * Keeps per tree an interval containing the answer and halves the largest one around its middle element,
+     * narrowing every other interval by that element merged rank: O(k*log(n)) steps of O(k*log(n)).
+     */
+    void Select(const std::vector<Number> &low, const std::vector<Number> &high, Number target,
+                std::vector<Number> &split) const {
+        const size_t count = this->cursors.size();
+        std::vector<Number> from(low), to(high);
+        std::vector<Number> before(count);
+        while (true) {
+            size_t widest = count;
+            for (size_t i = 0; i < count; ++i) {
+                if (from[i] < to[i] && (widest == count || to[i] - from[i] > to[widest] - from[widest])) {
+                    widest = i;
+                }
+            }
+            if (widest == count) {
+                break;
+            }
+            const Number middle = from[widest] + (to[widest] - from[widest]) / 2;
+            const Key key = this->cursors[widest].tree->FindIndexNode(middle)->key;
+            Number rank = 0;
+            for (size_t i = 0; i < count; ++i) {
+                before[i] = (i == widest ? middle : this->CountBefore(i, key, widest, low[i], high[i]));
+                rank += before[i] - low[i];
+            }
+            if (rank < target) {
+                // The middle element and everything before it are selected.
+                for (size_t i = 0; i < count; ++i) {
+                    from[i] = std::max(from[i], before[i] + (i == widest ? 1 : 0));
+                }
+            } else {
+                for (size_t i = 0; i < count; ++i) {
+                    to[i] = std::min(to[i], before[i]);
+                }
+            }
+        }
+        split = from;
+    }
+
+public:
+    /**
+     * Constructor: Positions the iterator on the first element of the merged range.
+     * @note Worst-Time Complexity: O(k*log(n)), O((k*log(n))^2) with an offset.
+     * @param trees - Array of the trees to merge.
+     * @param count - Amount of trees.
+     * @param filter - Range, order, limit and filter function of the iteration (see Query).
+     * @param offset - Amount of leading elements of the merged range to skip (Default: 0).
+     */
+    MergeIterator(const Tree *const *trees, size_t count,
+                  const AVL::FilterObject<Key, Value, Number> &filter = AVL::FilterObject<Key, Value, Number>(),
+                  Number offset = 0) :
+            cursors(count),
+            losers(),
+            leaves(1),
+            winner(0),
+            reverse(filter.reverse),
+            limit(filter.limit),
+            filter_function(filter.FilterFunction),
+            compare() {
+        std::vector<Number> low(count), high(count), split;
+        Number total = 0;
+        for (size_t i = 0; i < count; ++i) {
+            this->cursors[i].tree = trees[i];
+            low[i] = filter.min_range ? trees[i]->CountLessThan(*filter.min_range) : 0;
+            high[i] = std::max(low[i], filter.max_range ? trees[i]->CountLessOrEqual(*filter.max_range)
+                                                        : trees[i]->GetSize());
+            total += high[i] - low[i];
+        }
+        offset = std::max(std::min(offset, total), (Number) 0);
+        if (offset == 0) {
+            split = (this->reverse ? high : low);
+        } else {
+            this->Select(low, high, this->reverse ? total - offset : offset, split);
+        }
+        for (size_t i = 0; i < count; ++i) {
+            Cursor &cursor = this->cursors[i];
+            cursor.remaining = (this->reverse ? split[i] - low[i] : high[i] - split[i]);
+            cursor.node = (cursor.remaining > 0 ? trees[i]->FindIndexNode(this->reverse ? split[i] - 1 : split[i])
+                                                : NULL);
+        }
+        while (this->leaves < count) {
+            this->leaves *= 2;
+        }
+        this->losers.resize(this->leaves);
+        this->winner = this->Build(1);
+    }
+
+    /**
+     * Constructor: Positions the iterator on the first element of the merged range.
+     * @note Worst-Time Complexity: O(k*log(n)), O((k*log(n))^2) with an offset.
+     * @param trees - The trees to merge.
+     * @param filter - Range, order, limit and filter function of the iteration (see Query).
+     * @param offset - Amount of leading elements of the merged range to skip (Default: 0).
+     */
+    explicit MergeIterator(const std::vector<const Tree *> &trees,
+                           const AVL::FilterObject<Key, Value, Number> &filter =
+                           AVL::FilterObject<Key, Value, Number>(),
+                           Number offset = 0) :
+            MergeIterator(trees.empty() ? NULL : &trees[0], trees.size(), filter, offset) {}
+
+    /**
+     * Gets the node of the next element and advances.
+     * @note Worst-Time Complexity: O(log(k) + log(n)), O(log(k)) amortized per tree node.
+     * @return {Node<Key, Value, RankInfo, Number>} node of the next element or NULL when done.
+     */
+    TreeNode *NextNode() {
+        while (this->limit != 0 && this->winner < this->cursors.size() &&
+               this->cursors[this->winner].remaining > 0) {
+            Cursor &cursor = this->cursors[this->winner];
+            TreeNode *node = cursor.node;
+            if (--cursor.remaining > 0) {
+                cursor.node = (this->reverse ? cursor.tree->Prev(node) : cursor.tree->Next(node));
+            }
+            this->Replay();
+            if (!this->filter_function || this->filter_function(node->key, node->value)) {
+                if (this->limit > 0) {
+                    --this->limit;
+                }
+                return node;
+            }
+        }
+        return NULL;
+    }
+
+    /**
+     * Gets the next element and advances.
+     * @note Worst-Time Complexity: O(log(k) + log(n)), O(log(k)) amortized per tree node.
+     * @param key - Receives the element key.
+     * @param value - Receives the element value.
+     * @return {bool} True if an element was produced, False when done.
+     */
+    bool Next(Key &key, Value &value) {
+        const TreeNode *node = this->NextNode();
+        if (!node) {
+            return false;
+        }
+        key = node->key;
+        value = node->value;
+        return true;
+    }
+
+    /**
+     * Gets the amount of range elements left, bounded by the remaining limit.
+     * @note Worst-Time Complexity: O(k).
+     * @note FilterFunction is not applied, so fewer elements may actually be produced.
+     * @return {Number} Upper bound of the elements left.
+     */
+    Number GetRemaining() const {
+        Number remaining = 0;
+        for (size_t i = 0; i < this->cursors.size(); ++i) {
+            remaining += this->cursors[i].remaining;
+        }
+        return this->limit > -1 ? std::min(remaining, this->limit) : remaining;
+    }
+};
+
+#endif
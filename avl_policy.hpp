@@ -0,0 +1,47 @@
+/**
+ * Policy based Generic AVL (Balanced) Tree.
+ *
+ * @file avl_policy.hpp
+ *
+ * @brief AVL rank tree whose optional features (parent pointers, min/max caching, rank augmentation and
+ * operation stats) are compile time policies, so disabled features cost neither node memory nor code.
+ *
+ * @author Liav Barsheshet
+ * Contact: liavbarsheshet@gmail.com
+ *
+ * This implementation is free: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This implementation is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+#include "avl.hpp"
+
+#ifndef _AVL_POLICY_HPP
+#define _AVL_POLICY_HPP
+
+namespace AVL {
+    /**
+     * AVLRankTree with the policy as its third template parameter (a plain ordered map by default).
+     * The policies are template parameters of AVLRankTree itself (see TreePolicy), this alias only reorders them.
+     * @tparam Key - The type/class of the key.
+     * @tparam Value - The type/class of the value.
+     * @tparam Policy - Tree Policy Class (see TreePolicy).
+     * @tparam Number - Class/Primitive for numbers representation.
+     * @tparam RankInfo - Inherited Rank Class (used only with rank augmentation).
+     * @tparam Compare - Compare Function Object.
+     */
+    template<typename Key, typename Value,
+            AVL_TREE_POLICY Policy = OrderedMapPolicy,
+            typename Number = long long,
+            class RankInfo = DefaultRank<Key, Value, Number>,
+            class Compare = CompareFunc<Key>>
+    using AVLPolicyTree = AVLRankTree<Key, Value, Number, RankInfo, Compare, Policy>;
+}
+
+#endif
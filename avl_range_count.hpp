@@ -0,0 +1,311 @@
+/**
+ * Static 2D range counting index built from a Generic AVL (Balanced) Rank Tree snapshot.
+ *
+ * @file avl_range_count.hpp
+ *
+ * @brief Counts the elements with a key in [a, b] and a secondary attribute in [c, d].
+ *
+ * @author Liav Barsheshet
+ * Contact: liavbarsheshet@gmail.com
+ *
+ * This implementation is free: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This implementation is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+#include <stdint.h>
+#include <algorithm>
+#include "avl.hpp"
+
+#ifndef _AVL_RANGE_COUNT_HPP
+#define _AVL_RANGE_COUNT_HPP
+
+namespace AVL {
+    template<typename Number = long long>
+    class RankBitVector;
+
+    template<typename Key, typename Value, typename Attribute,
+            typename Number = long long,
+            class Compare = CompareFunc<Key>>
+    class RangeCountIndex;
+}
+
+/**
+ * Class: Static bit vector with constant time rank support.
+ * @tparam Number - Class/Primitive for numbers representation.
+ */
+template<typename Number>
+class AVL::RankBitVector {
+    uint64_t *words;
+    Number *ranks;
+    Number size;
+
+    static Number PopCount(uint64_t word) {
+#if defined(__GNUC__)
+        return (Number) __builtin_popcountll(word);
+#else
+        Number count = 0;
+        for (; word; word &= (word - 1)) {
+            ++count;
+        }
+        return count;
+#endif
+    }
+
+public:
+    RankBitVector() :
+            words(NULL),
+            ranks(NULL),
+            size(0) {}
+
+    RankBitVector(const RankBitVector<Number> &bits) = delete;
+
+    RankBitVector<Number> &operator=(const RankBitVector<Number> &bits) = delete;
+
+    ~RankBitVector() {
+        delete[] this->words;
+        delete[] this->ranks;
+    }
+
+    void Reset(Number size) {
+        delete[] this->words;
+        delete[] this->ranks;
+        this->size = size;
+        this->words = new uint64_t[size / 64 + 1]();
+        this->ranks = new Number[size / 64 + 1]();
+    }
+
+    void Set(Number index) {
+        this->words[index / 64] |= ((uint64_t) 1 << (index % 64));
+    }
+
+    bool Get(Number index) const {
+        return (this->words[index / 64] >> (index % 64)) & 1;
+    }
+
+    /* Must be called once all bits are set. */
+    void BuildRanks() {
+        Number ones = 0;
+        for (Number i = 0; i <= this->size / 64; ++i) {
+            this->ranks[i] = ones;
+            ones += PopCount(this->words[i]);
+        }
+    }
+
+    /* Amount of set bits in positions [0, index). */
+    Number Rank1(Number index) const {
+        const uint64_t mask = ((uint64_t) 1 << (index % 64)) - 1;
+        return this->ranks[index / 64] + PopCount(this->words[index / 64] & mask);
+    }
+
+    /* Amount of clear bits in positions [0, index). */
+    Number Rank0(Number index) const {
+        return index - this->Rank1(index);
+    }
+};
+
+/**
+ * Class: Static 2D Range Counting Index.
+ * Built from the in-order sequence of an AVL rank tree snapshot: keys are kept sorted for the first
+ * dimension and a wavelet matrix over the (compressed) secondary attributes answers the second one.
+ * @note The index does not follow later modifications of the tree, rebuild it from a new snapshot.
+ * @tparam Key - The type/class of the key.
+ * @tparam Value - The type/class of the value.
+ * @tparam Attribute - The type/class of the secondary attribute (requires operator<).
+ * @tparam Number - Class/Primitive for numbers representation.
+ * @tparam Compare - Compare Function Object of the keys.
+ */
+template<typename Key, typename Value, typename Attribute, typename Number, class Compare>
+class AVL::RangeCountIndex {
+    Number size;
+    Key *keys;
+
+    Number attributes_count;
+    Attribute *attributes;
+
+    Number levels;
+    AVL::RankBitVector<Number> *bits;
+    Number *zeros;
+
+    Compare compare;
+
+    Number LowerBound(const Key &key) const {
+        Number low = 0;
+        Number high = this->size;
+        while (low < high) {
+            const Number middle = low + (high - low) / 2;
+            if (this->compare(this->keys[middle], key) == LESS_THAN) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        return low;
+    }
+
+    Number UpperBound(const Key &key) const {
+        Number low = 0;
+        Number high = this->size;
+        while (low < high) {
+            const Number middle = low + (high - low) / 2;
+            if (this->compare(key, this->keys[middle]) == LESS_THAN) {
+                high = middle;
+            } else {
+                low = middle + 1;
+            }
+        }
+        return low;
+    }
+
+    /* Amount of positions in [begin, end) whose attribute code is less than bound. */
+    Number CountCodesLessThan(Number begin, Number end, Number bound) const {
+        if (bound >= ((Number) 1 << this->levels)) {
+            return end - begin;
+        }
+        Number count = 0;
+        for (Number level = 0; level < this->levels; ++level) {
+            const Number bit = (bound >> (this->levels - level - 1)) & 1;
+            const Number begin_zeros = this->bits[level].Rank0(begin);
+            const Number end_zeros = this->bits[level].Rank0(end);
+            if (bit) {
+                count += end_zeros - begin_zeros;
+                begin = this->zeros[level] + (begin - begin_zeros);
+                end = this->zeros[level] + (end - end_zeros);
+            } else {
+                begin = begin_zeros;
+                end = end_zeros;
+            }
+        }
+        return count;
+    }
+
+public:
+    /**
+     * Constructor: Builds the index from a snapshot of an AVL rank tree.
+     * @note Worst-Time Complexity: O(n*log(n)).
+     * @note Worst-Space Complexity: O(n*log(n)) bits + O(n) keys.
+     * @param tree - AVL rank tree as a reference.
+     * @param AttributeFunction - Extracts the secondary attribute of an element.
+     */
+    template<class RankInfo>
+    RangeCountIndex(const AVL::AVLRankTree<Key, Value, Number, RankInfo, Compare> &tree,
+                    Attribute (*AttributeFunction)(Key, Value)) :
+            size(tree.GetSize()),
+            keys(NULL),
+            attributes_count(0),
+            attributes(NULL),
+            levels(1),
+            bits(NULL),
+            zeros(NULL),
+            compare() {
+        this->keys = new Key[this->size];
+        this->attributes = new Attribute[this->size];
+        Attribute *sequence = new Attribute[this->size];
+
+        Number i = 0;
+        for (Node<Key, Value, RankInfo, Number> *node = tree.FindIndexNode(0); node; node = tree.Next(node)) {
+            this->keys[i] = node->key;
+            sequence[i] = AttributeFunction(node->key, node->value);
+            this->attributes[i] = sequence[i];
+            ++i;
+        }
+
+        // Compress the attributes into codes [0, attributes_count).
+        std::sort(this->attributes, this->attributes + this->size);
+        this->attributes_count = std::unique(this->attributes, this->attributes + this->size) - this->attributes;
+        while (((Number) 1 << this->levels) < this->attributes_count) {
+            ++this->levels;
+        }
+        Number *codes = new Number[this->size];
+        Number *next_codes = new Number[this->size];
+        for (i = 0; i < this->size; ++i) {
+            codes[i] = std::lower_bound(this->attributes, this->attributes + this->attributes_count, sequence[i]) -
+                       this->attributes;
+        }
+        delete[] sequence;
+
+        // Wavelet matrix: each level stably moves the codes with a clear bit before the codes with a set bit.
+        this->bits = new AVL::RankBitVector<Number>[this->levels];
+        this->zeros = new Number[this->levels];
+        for (Number level = 0; level < this->levels; ++level) {
+            const Number shift = this->levels - level - 1;
+            this->bits[level].Reset(this->size);
+            this->zeros[level] = 0;
+            for (i = 0; i < this->size; ++i) {
+                if ((codes[i] >> shift) & 1) {
+                    this->bits[level].Set(i);
+                } else {
+                    ++this->zeros[level];
+                }
+            }
+            this->bits[level].BuildRanks();
+            Number zero_position = 0;
+            Number one_position = this->zeros[level];
+            for (i = 0; i < this->size; ++i) {
+                if ((codes[i] >> shift) & 1) {
+                    next_codes[one_position++] = codes[i];
+                } else {
+                    next_codes[zero_position++] = codes[i];
+                }
+            }
+            std::swap(codes, next_codes);
+        }
+        delete[] codes;
+        delete[] next_codes;
+    }
+
+    RangeCountIndex(const RangeCountIndex &index) = delete;
+
+    RangeCountIndex &operator=(const RangeCountIndex &index) = delete;
+
+    /**
+     * Destructor: Deallocates the entire index.
+     * @note Worst-Time Complexity: O(1).
+     */
+    ~RangeCountIndex() {
+        delete[] this->keys;
+        delete[] this->attributes;
+        delete[] this->bits;
+        delete[] this->zeros;
+    }
+
+    /**
+     * Gets the amount of indexed elements.
+     * @note Worst-Time Complexity: O(1).
+     * @return {Number} Amount of elements.
+     */
+    Number GetSize() const {
+        return this->size;
+    }
+
+    /**
+     * Counts the elements with a key in [min_key, max_key] and an attribute in [min_attribute, max_attribute].
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param min_key - The key range lower bound (inclusive).
+     * @param max_key - The key range upper bound (inclusive).
+     * @param min_attribute - The attribute range lower bound (inclusive).
+     * @param max_attribute - The attribute range upper bound (inclusive).
+     * @return {Number} Amount of elements within both ranges.
+     */
+    Number Count(const Key &min_key, const Key &max_key,
+                 const Attribute &min_attribute, const Attribute &max_attribute) const {
+        const Number begin = this->LowerBound(min_key);
+        const Number end = this->UpperBound(max_key);
+        if (begin >= end || max_attribute < min_attribute) {
+            return 0;
+        }
+        const Number low_code = std::lower_bound(this->attributes, this->attributes + this->attributes_count,
+                                                 min_attribute) - this->attributes;
+        const Number high_code = std::upper_bound(this->attributes, this->attributes + this->attributes_count,
+                                                  max_attribute) - this->attributes;
+        return this->CountCodesLessThan(begin, end, high_code) - this->CountCodesLessThan(begin, end, low_code);
+    }
+};
+
+#endif
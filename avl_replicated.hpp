@@ -0,0 +1,576 @@
+/**
+ * NUMA replicated read-mostly wrapper of the Generic AVL (Balanced) Rank Tree.
+ *
+ * @file avl_replicated.hpp
+ *
+ * @brief One AVL rank tree replica per NUMA node, kept in sync through a shared operation log.
+ *
+ * @author Liav Barsheshet
+ * Contact: liavbarsheshet@gmail.com
+ *
+ * This implementation is free: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This implementation is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+#include <stdio.h>
+#include <atomic>
+#include <mutex>
+#include <utility>
+#include "avl.hpp"
+
+#if __cplusplus >= 201402L
+#include <shared_mutex>
+#elif defined(__unix__)
+#include <pthread.h>
+#endif
+
+#if defined(__linux__)
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+#ifndef _AVL_REPLICATED_HPP
+#define _AVL_REPLICATED_HPP
+
+namespace AVL {
+    class SharedMutex;
+
+    template<typename Key, typename Value,
+            typename Number = long long,
+            class RankInfo = DefaultRank<Key, Value, Number>,
+            class Compare = CompareFunc<Key>>
+    class ReplicatedRankTree;
+}
+
+/**
+ * Class: Reader-writer lock.
+ * std::shared_mutex from C++17 (std::shared_timed_mutex in C++14), a pthread rwlock before that and an exclusive
+ * mutex where neither is available.
+ */
+class AVL::SharedMutex {
+#if __cplusplus >= 201703L
+    std::shared_mutex mutex;
+#elif __cplusplus >= 201402L
+    std::shared_timed_mutex mutex;
+#elif defined(__unix__)
+    pthread_rwlock_t mutex;
+#else
+    std::mutex mutex;
+#endif
+
+public:
+#if __cplusplus < 201402L && defined(__unix__)
+    SharedMutex() {
+        pthread_rwlock_init(&this->mutex, NULL);
+    }
+
+    ~SharedMutex() {
+        pthread_rwlock_destroy(&this->mutex);
+    }
+
+    void lock() {
+        pthread_rwlock_wrlock(&this->mutex);
+    }
+
+    void unlock() {
+        pthread_rwlock_unlock(&this->mutex);
+    }
+
+    void lock_shared() {
+        pthread_rwlock_rdlock(&this->mutex);
+    }
+
+    void unlock_shared() {
+        pthread_rwlock_unlock(&this->mutex);
+    }
+#elif __cplusplus < 201402L
+    SharedMutex() {}
+
+    void lock() {
+        this->mutex.lock();
+    }
+
+    void unlock() {
+        this->mutex.unlock();
+    }
+
+    void lock_shared() {
+        this->mutex.lock();
+    }
+
+    void unlock_shared() {
+        this->mutex.unlock();
+    }
+#else
+    SharedMutex() {}
+
+    void lock() {
+        this->mutex.lock();
+    }
+
+    void unlock() {
+        this->mutex.unlock();
+    }
+
+    void lock_shared() {
+        this->mutex.lock_shared();
+    }
+
+    void unlock_shared() {
+        this->mutex.unlock_shared();
+    }
+#endif
+
+    SharedMutex(const SharedMutex &mutex) = delete;
+
+    SharedMutex &operator=(const SharedMutex &mutex) = delete;
+};
+
+/**
+ * Class: NUMA Replicated AVL Rank Tree.
+ * Keeps one replica per NUMA node. Writes are appended to a shared operation log and every replica replays
+ * the log lazily, right before it serves a read, so its nodes are allocated (first touched) by threads of
+ * its own node. Each thread is routed to the replica of the node it is currently running on.
+ * Reads of an up to date replica share its lock, it is taken exclusively only to replay the log. The log is a
+ * list of fixed blocks whose slots never move once published, so replicas replay it without the log lock.
+ * @note Writes are linearized by the log, reads see every write that completed before they started.
+ * @note A replica that is never read keeps the log from being truncated, use SyncAll() to drain it.
+ * @tparam Key - The type/class of the key.
+ * @tparam Value - The type/class of the value.
+ * @tparam Number - Class/Primitive for numbers representation.
+ * @tparam RankInfo - Class of rank information.
+ * @tparam Compare - Compare Function Object of the keys.
+ */
+template<typename Key, typename Value, typename Number, class RankInfo, class Compare>
+class AVL::ReplicatedRankTree {
+public:
+    typedef AVL::AVLRankTree<Key, Value, Number, RankInfo, Compare> Tree;
+
+protected:
+    typedef enum {
+        INSERT, INSERT_OR_ASSIGN, REMOVE, CHANGE_KEY
+    } OPERATION_TYPE;
+
+    class Operation {
+    public:
+        OPERATION_TYPE type;
+        Key key;
+        Key new_key;
+        Value value;
+    };
+
+    static const size_t LOG_BLOCK_SIZE = 256;
+
+    /* Operations [base, base + LOG_BLOCK_SIZE) of the log. */
+    class LogBlock {
+    public:
+        size_t base;
+        std::atomic<LogBlock *> next;
+        Operation operations[LOG_BLOCK_SIZE];
+
+        explicit LogBlock(size_t base) :
+                base(base),
+                next(NULL) {}
+    };
+
+    class Replica {
+    public:
+        AVL::SharedMutex mutex;
+        std::atomic<size_t> applied;
+        /* Block of the next operation to replay (or the last one when it ends at applied). */
+        LogBlock *block;
+        Tree tree;
+
+        Replica() :
+                applied(0),
+                block(NULL) {}
+    };
+
+    /* Calls of a thread between two refreshes of its cached node. */
+    static const unsigned NODE_REFRESH_PERIOD = 64;
+
+    Replica *replicas;
+    size_t replicas_count;
+
+    /*
+     * The log holds the operations [log_head->base, log_end). Appending is serialized by log_mutex, log_end is
+     * published after the slot is written so replicas read the slots below it without the lock.
+     */
+    std::mutex log_mutex;
+    LogBlock *log_head;
+    LogBlock *log_tail;
+    std::atomic<size_t> log_end;
+
+    /* Holds a shared lock for its scope (std::shared_lock is C++14). */
+    class SharedLock {
+        AVL::SharedMutex &mutex;
+
+    public:
+        explicit SharedLock(AVL::SharedMutex &mutex) :
+                mutex(mutex) {
+            this->mutex.lock_shared();
+        }
+
+        ~SharedLock() {
+            this->mutex.unlock_shared();
+        }
+
+        SharedLock(const SharedLock &lock) = delete;
+
+        SharedLock &operator=(const SharedLock &lock) = delete;
+    };
+
+    static bool Apply(Tree &tree, const Operation &operation) {
+        switch (operation.type) {
+            case INSERT:
+                tree.Insert(operation.key, operation.value);
+                return true;
+            case INSERT_OR_ASSIGN:
+                return tree.InsertOrAssign(operation.key, operation.value);
+            case REMOVE:
+                return tree.Remove(operation.key);
+            case CHANGE_KEY:
+                return tree.ChangeKey(operation.key, operation.new_key);
+        }
+        return false;
+    }
+
+    /**
+     * Replays the log into a replica (its mutex must be held exclusively).
+     * @note The published slots are read in place, the log lock is not taken.
+     * @param replica - The replica.
+     * @param target - Sequence number of the operation whose result is requested.
+     * @param result - Receives the result of the target operation (Optional).
+     */
+    void Sync(Replica &replica, size_t target = 0, bool *result = NULL) {
+        size_t applied = replica.applied.load(std::memory_order_relaxed);
+        const size_t end = this->log_end.load(std::memory_order_acquire);
+        if (applied == end) {
+            return;
+        }
+        for (; applied < end; ++applied) {
+            if (applied == replica.block->base + LOG_BLOCK_SIZE) {
+                replica.block = replica.block->next.load(std::memory_order_acquire);
+            }
+            const bool applied_result = Apply(replica.tree, replica.block->operations[applied - replica.block->base]);
+            if (result && applied == target) {
+                *result = applied_result;
+            }
+        }
+        replica.applied.store(applied, std::memory_order_release);
+    }
+
+    /* Frees the log blocks that every replica has left behind (the log mutex must be held). */
+    void Truncate() {
+        size_t min_applied = this->log_end.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < this->replicas_count; ++i) {
+            const size_t applied = this->replicas[i].applied.load(std::memory_order_acquire);
+            min_applied = (applied < min_applied ? applied : min_applied);
+        }
+        // A replica may still point to the block ending exactly at its applied, so that block is kept.
+        while (this->log_head != this->log_tail && this->log_head->base + LOG_BLOCK_SIZE < min_applied) {
+            LogBlock *block = this->log_head;
+            this->log_head = block->next.load(std::memory_order_relaxed);
+            delete block;
+        }
+    }
+
+    bool Execute(const Operation &operation) {
+        // Node replication: the writer replays on its local replica to learn the result of its operation.
+        // The replica is locked first so no other thread can replay the operation before its writer does.
+        Replica &replica = this->LocalReplica();
+        std::lock_guard<AVL::SharedMutex> replica_lock(replica.mutex);
+        size_t sequence;
+        {
+            std::lock_guard<std::mutex> lock(this->log_mutex);
+            sequence = this->log_end.load(std::memory_order_relaxed);
+            if (sequence == this->log_tail->base + LOG_BLOCK_SIZE) {
+                LogBlock *block = new LogBlock(sequence);
+                this->log_tail->next.store(block, std::memory_order_release);
+                this->log_tail = block;
+                this->Truncate();
+            }
+            this->log_tail->operations[sequence - this->log_tail->base] = operation;
+            this->log_end.store(sequence + 1, std::memory_order_release);
+        }
+        bool result = false;
+        this->Sync(replica, sequence, &result);
+        return result;
+    }
+
+    Replica &LocalReplica() {
+        return this->replicas[(size_t) CurrentNode() % this->replicas_count];
+    }
+
+public:
+    /**
+     * Gets the NUMA node of the calling thread.
+     * @note Worst-Time Complexity: O(1).
+     * @note The node is cached per thread and refreshed every NODE_REFRESH_PERIOD calls, so a migrated thread
+     * keeps using its previous replica for a while (still correct, only remote).
+     * @return {int} Node of the CPU the thread runs on, 0 if unknown.
+     */
+    static int CurrentNode() {
+        static thread_local int node = 0;
+        static thread_local unsigned calls = 0;
+        if (calls++ % NODE_REFRESH_PERIOD == 0) {
+            node = QueryNode();
+        }
+        return node;
+    }
+
+    /**
+     * Asks the kernel for the NUMA node of the calling thread (vDSO getcpu where glibc provides it).
+     * @note Worst-Time Complexity: O(1).
+     * @return {int} Node of the CPU the thread runs on, 0 if unknown.
+     */
+    static int QueryNode() {
+#if defined(__linux__) && defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 29)) && \
+    defined(_GNU_SOURCE)
+        unsigned cpu = 0;
+        unsigned node = 0;
+        if (getcpu(&cpu, &node) == 0) {
+            return (int) node;
+        }
+#elif defined(__linux__) && defined(SYS_getcpu)
+        unsigned cpu = 0;
+        unsigned node = 0;
+        if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0) {
+            return (int) node;
+        }
+#endif
+        return 0;
+    }
+
+    /**
+     * Gets the amount of NUMA nodes of the machine.
+     * @note Worst-Time Complexity: O(1).
+     * @return {size_t} Amount of nodes, 1 if unknown.
+     */
+    static size_t DetectNodes() {
+        size_t nodes = 1;
+#if defined(__linux__)
+        FILE *file = fopen("/sys/devices/system/node/online", "r");
+        if (!file) {
+            return nodes;
+        }
+        // Format: comma separated ranges, e.g. "0-1,3".
+        unsigned node = 0;
+        while (fscanf(file, "%u", &node) == 1) {
+            nodes = (node + 1 > nodes ? node + 1 : nodes);
+            if (fgetc(file) == EOF) {
+                break;
+            }
+        }
+        fclose(file);
+#endif
+        return nodes;
+    }
+
+    /**
+     * Constructor: Constructs empty replicas.
+     * @note Worst-Time Complexity: O(replicas).
+     * @param replicas_count - Amount of replicas (Default: one per NUMA node).
+     */
+    explicit ReplicatedRankTree(size_t replicas_count = DetectNodes()) :
+            replicas(NULL),
+            replicas_count(replicas_count ? replicas_count : 1),
+            log_head(NULL),
+            log_tail(NULL),
+            log_end(0) {
+        this->log_head = this->log_tail = new LogBlock(0);
+        this->replicas = new Replica[this->replicas_count];
+        for (size_t i = 0; i < this->replicas_count; ++i) {
+            this->replicas[i].block = this->log_head;
+        }
+    }
+
+    ReplicatedRankTree(const ReplicatedRankTree &tree) = delete;
+
+    ReplicatedRankTree &operator=(const ReplicatedRankTree &tree) = delete;
+
+    /**
+     * Destructor: Deallocates every replica and the log.
+     * @note Worst-Time Complexity: O(replicas*n + log).
+     */
+    ~ReplicatedRankTree() {
+        delete[] this->replicas;
+        while (this->log_head) {
+            LogBlock *block = this->log_head;
+            this->log_head = block->next.load(std::memory_order_relaxed);
+            delete block;
+        }
+    }
+
+    /**
+     * Gets the amount of replicas.
+     * @note Worst-Time Complexity: O(1).
+     * @return {size_t} Amount of replicas.
+     */
+    size_t GetReplicasCount() const {
+        return this->replicas_count;
+    }
+
+    /**
+     * Insert new element to the tree.
+     * @note Worst-Time Complexity: O(log(n)) + replay of the local replica.
+     * @param key - The element key.
+     * @param value - The element value.
+     */
+    void Insert(const Key key, const Value value) {
+        Operation operation = Operation();
+        operation.type = INSERT;
+        operation.key = key;
+        operation.value = value;
+        this->Execute(operation);
+    }
+
+    /**
+     * Inserts a new element or assigns the value of an existing element with the same key.
+     * @note Worst-Time Complexity: O(log(n)) + replay of the local replica.
+     * @param key - The element key.
+     * @param value - The element value.
+     * @return {bool} True if a new element was inserted, False if an existing one was assigned.
+     */
+    bool InsertOrAssign(const Key key, const Value value) {
+        Operation operation = Operation();
+        operation.type = INSERT_OR_ASSIGN;
+        operation.key = key;
+        operation.value = value;
+        return this->Execute(operation);
+    }
+
+    /**
+     * Removes an element from the tree.
+     * @note Worst-Time Complexity: O(log(n)) + replay of the local replica.
+     * @param key - The element key.
+     * @return {bool} True if removed o.w False.
+     */
+    bool Remove(const Key key) {
+        Operation operation = Operation();
+        operation.type = REMOVE;
+        operation.key = key;
+        return this->Execute(operation);
+    }
+
+    /**
+     * Changes the key of an element.
+     * @note Worst-Time Complexity: O(log(n)) + replay of the local replica.
+     * @param old_key - The current element key.
+     * @param new_key - The new element key.
+     * @return {bool} True if the element was found o.w False.
+     */
+    bool ChangeKey(const Key old_key, const Key new_key) {
+        Operation operation = Operation();
+        operation.type = CHANGE_KEY;
+        operation.key = old_key;
+        operation.new_key = new_key;
+        return this->Execute(operation);
+    }
+
+    /**
+     * Runs a read-only function on the up to date local replica.
+     * @note Worst-Time Complexity: O(function) + replay of the local replica.
+     * @note The function runs under the shared lock of the replica, concurrently with other readers.
+     * @note Nodes and pointers obtained inside the function must not be used after it returns.
+     * @tparam Function - Callable object with the signature Result(const Tree &).
+     * @param function - Receives the local replica.
+     * @return The result of the function.
+     */
+    template<typename Function>
+    auto Read(Function function) -> decltype(function(std::declval<const Tree &>())) {
+        Replica &replica = this->LocalReplica();
+        // The replica only moves forward, so once it reached the log end seen here the read is up to date.
+        if (replica.applied.load(std::memory_order_acquire) != this->log_end.load(std::memory_order_acquire)) {
+            std::lock_guard<AVL::SharedMutex> lock(replica.mutex);
+            this->Sync(replica);
+        }
+        SharedLock lock(replica.mutex);
+        return function(static_cast<const Tree &>(replica.tree));
+    }
+
+    /**
+     * Find an element by its key.
+     * @note Worst-Time Complexity: O(log(n)) + replay of the local replica.
+     * @param key - The element key.
+     * @param value - Receives the element value.
+     * @return {bool} True if found o.w False.
+     */
+    bool Find(const Key key, Value &value) {
+        return this->Read([&](const Tree &tree) -> bool {
+            const AVL::Node<Key, Value, RankInfo, Number> *node = tree.FindNode(key);
+            if (!node) {
+                return false;
+            }
+            value = node->value;
+            return true;
+        });
+    }
+
+    /**
+     * Find an element by its index.
+     * @note Worst-Time Complexity: O(log(n)) + replay of the local replica.
+     * @param index - The element index as if it was in a sorted array.
+     * @param key - Receives the element key.
+     * @param value - Receives the element value.
+     * @return {bool} True if the index is in range o.w False.
+     */
+    bool FindIndex(const Number index, Key &key, Value &value) {
+        return this->Read([&](const Tree &tree) -> bool {
+            const AVL::Node<Key, Value, RankInfo, Number> *node = tree.FindIndexNode(index);
+            if (!node) {
+                return false;
+            }
+            key = node->key;
+            value = node->value;
+            return true;
+        });
+    }
+
+    /**
+     * Gets the index of a specific elements by key.
+     * @note Worst-Time Complexity: O(log(n)) + replay of the local replica.
+     * @param key - The element key.
+     * @return {Number} Index of an element as if it was in a sorted array.
+     */
+    Number GetIndexOfKey(const Key key) {
+        return this->Read([&](const Tree &tree) -> Number {
+            return tree.GetIndexOfKey(key);
+        });
+    }
+
+    /**
+     * Gets the tree size.
+     * @note Worst-Time Complexity: O(1) + replay of the local replica.
+     * @return {Number} Tree size.
+     */
+    Number GetSize() {
+        return this->Read([](const Tree &tree) -> Number {
+            return tree.GetSize();
+        });
+    }
+
+    /**
+     * Replays the log into every replica and truncates it.
+     * @note Worst-Time Complexity: O(replicas*pending*log(n)).
+     * @note Allocations of the replayed nodes happen on the calling thread.
+     */
+    void SyncAll() {
+        for (size_t i = 0; i < this->replicas_count; ++i) {
+            std::lock_guard<AVL::SharedMutex> lock(this->replicas[i].mutex);
+            this->Sync(this->replicas[i]);
+        }
+        std::lock_guard<std::mutex> lock(this->log_mutex);
+        this->Truncate();
+    }
+};
+
+#endif
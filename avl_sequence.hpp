@@ -0,0 +1,511 @@
+/**
+ * Implicit-key AVL sequence (indexed list / rope).
+ *
+ * @file avl_sequence.hpp
+ *
+ * @brief Ordered sequence of values addressed purely by position, no key is stored or compared.
+ *
+ * @author Liav Barsheshet
+ * Contact: liavbarsheshet@gmail.com
+ *
+ * This implementation is free: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This implementation is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+#include <stdexcept>
+#include "avl.hpp"
+
+#ifndef _AVL_SEQUENCE_HPP
+#define _AVL_SEQUENCE_HPP
+
+namespace AVL {
+    template<typename Value, typename Number = long long>
+    class SumRank;
+
+    template<typename Value, class RankInfo, typename Number = long long>
+    class SequenceNode;
+
+    template<typename Value,
+            typename Number = long long,
+            class RankInfo = SumRank<Value, Number>>
+    class AVLSequence;
+}
+
+/**
+ * [Example] Class: Default rank information of a sequence (element count and sum of values).
+ * Sequence rank information is constructed from a value only and must keep the element count in rank.
+ * @note Aggregates must not depend on the order of the elements (Reverse is lazy).
+ * @tparam Value - The type/class of the value.
+ * @tparam Number - Class/Primitive for numbers representation.
+ */
+template<typename Value, typename Number>
+class AVL::SumRank {
+public:
+    Number rank;
+    Value sum;
+
+    SumRank() :
+            rank(0),
+            sum() {}
+
+    explicit SumRank(Value value) :
+            rank(1),
+            sum(value) {}
+
+    SumRank(const SumRank<Value, Number> &_rank) :
+            rank(_rank.rank),
+            sum(_rank.sum) {}
+
+    ~SumRank() {}
+
+    AVL::SumRank<Value, Number> &operator=(const SumRank<Value, Number> &_rank) {
+        this->rank = _rank.rank;
+        this->sum = _rank.sum;
+        return (*this);
+    }
+
+    AVL::SumRank<Value, Number> &operator-=(const SumRank<Value, Number> &_rank) {
+        this->rank -= _rank.rank;
+        this->sum -= _rank.sum;
+        return (*this);
+    }
+
+    AVL::SumRank<Value, Number> &operator+=(const SumRank<Value, Number> &_rank) {
+        this->rank += _rank.rank;
+        this->sum += _rank.sum;
+        return (*this);
+    }
+
+    std::ostream &Print(std::ostream &os) const {
+        os << "{" << this->rank << ", " << this->sum << "}";
+        return os;
+    }
+};
+
+/**
+ * Class: Represents nodes inside the AVL Sequence.
+ * @tparam Value - The type/class of the value.
+ * @tparam RankInfo - Sequence Rank Class.
+ * @tparam Number - Class/Primitive for numbers representation.
+ */
+template<typename Value, class RankInfo, typename Number>
+class AVL::SequenceNode {
+public:
+    SequenceNode *left_child;
+    SequenceNode *right_child;
+
+    Value value;
+    Number height;
+    /* The children of this node must be swapped before they are visited. */
+    bool reversed;
+
+    RankInfo rank;
+
+    explicit SequenceNode(Value value) :
+            left_child(NULL),
+            right_child(NULL),
+            value(value),
+            height(0),
+            reversed(false),
+            rank(value) {}
+};
+
+/**
+ * Class: Represents an AVL Sequence.
+ * Positions are navigated through the element count kept in the rank information, and every
+ * structural operation is built from AVL split and join, so no key is stored or compared.
+ * @tparam Value - The type/class of the value.
+ * @tparam Number - Class/Primitive for numbers representation.
+ * @tparam RankInfo - Sequence Rank Class.
+ */
+template<typename Value, typename Number, class RankInfo>
+class AVL::AVLSequence {
+    AVL::SequenceNode<Value, RankInfo, Number> *root;
+
+    Number GetHeight(AVL::SequenceNode<Value, RankInfo, Number> *node) const {
+        if (!node) {
+            return -1;
+        }
+        return node->height;
+    }
+
+    Number GetSize(AVL::SequenceNode<Value, RankInfo, Number> *node) const {
+        if (!node) {
+            return 0;
+        }
+        return node->rank.rank;
+    }
+
+    void Push(AVL::SequenceNode<Value, RankInfo, Number> *node) {
+        if (!node || !node->reversed) {
+            return;
+        }
+        std::swap(node->left_child, node->right_child);
+        if (node->left_child) {
+            node->left_child->reversed = !node->left_child->reversed;
+        }
+        if (node->right_child) {
+            node->right_child->reversed = !node->right_child->reversed;
+        }
+        node->reversed = false;
+    }
+
+    void Update(AVL::SequenceNode<Value, RankInfo, Number> *node) {
+        node->height = (std::max(this->GetHeight(node->left_child), this->GetHeight(node->right_child)) + 1);
+        node->rank = RankInfo(node->value);
+        if (node->left_child) {
+            node->rank += node->left_child->rank;
+        }
+        if (node->right_child) {
+            node->rank += node->right_child->rank;
+        }
+    }
+
+    AVL::SequenceNode<Value, RankInfo, Number> *RotateR(AVL::SequenceNode<Value, RankInfo, Number> *node) {
+        AVL::SequenceNode<Value, RankInfo, Number> *y = node->left_child;
+        node->left_child = y->right_child;
+        y->right_child = node;
+        this->Update(node);
+        this->Update(y);
+        return y;
+    }
+
+    AVL::SequenceNode<Value, RankInfo, Number> *RotateL(AVL::SequenceNode<Value, RankInfo, Number> *node) {
+        AVL::SequenceNode<Value, RankInfo, Number> *y = node->right_child;
+        node->right_child = y->left_child;
+        y->left_child = node;
+        this->Update(node);
+        this->Update(y);
+        return y;
+    }
+
+    /* Expects pushed node, and balance factors within [-2, 2]. */
+    AVL::SequenceNode<Value, RankInfo, Number> *Balance(AVL::SequenceNode<Value, RankInfo, Number> *node) {
+        const Number balance = this->GetHeight(node->left_child) - this->GetHeight(node->right_child);
+        if (balance > 1) {
+            this->Push(node->left_child);
+            if (this->GetHeight(node->left_child->left_child) < this->GetHeight(node->left_child->right_child)) {
+                this->Push(node->left_child->right_child);
+                node->left_child = this->RotateL(node->left_child);
+            }
+            return this->RotateR(node);
+        }
+        if (balance < -1) {
+            this->Push(node->right_child);
+            if (this->GetHeight(node->right_child->right_child) < this->GetHeight(node->right_child->left_child)) {
+                this->Push(node->right_child->left_child);
+                node->right_child = this->RotateR(node->right_child);
+            }
+            return this->RotateL(node);
+        }
+        return node;
+    }
+
+    /* Joins left + middle + right, where every element of left precedes every element of right. */
+    AVL::SequenceNode<Value, RankInfo, Number> *Join(AVL::SequenceNode<Value, RankInfo, Number> *left,
+                                                     AVL::SequenceNode<Value, RankInfo, Number> *middle,
+                                                     AVL::SequenceNode<Value, RankInfo, Number> *right) {
+        if (this->GetHeight(left) > this->GetHeight(right) + 1) {
+            this->Push(left);
+            left->right_child = this->Join(left->right_child, middle, right);
+            this->Update(left);
+            return this->Balance(left);
+        }
+        if (this->GetHeight(right) > this->GetHeight(left) + 1) {
+            this->Push(right);
+            right->left_child = this->Join(left, middle, right->left_child);
+            this->Update(right);
+            return this->Balance(right);
+        }
+        middle->left_child = left;
+        middle->right_child = right;
+        middle->reversed = false;
+        this->Update(middle);
+        return middle;
+    }
+
+    AVL::SequenceNode<Value, RankInfo, Number> *Concat(AVL::SequenceNode<Value, RankInfo, Number> *left,
+                                                       AVL::SequenceNode<Value, RankInfo, Number> *right) {
+        if (!left) {
+            return right;
+        }
+        if (!right) {
+            return left;
+        }
+        AVL::SequenceNode<Value, RankInfo, Number> *last;
+        this->Split(left, this->GetSize(left) - 1, &left, &last);
+        return this->Join(left, last, right);
+    }
+
+    /* Splits a subtree into its first index elements and the rest. */
+    void Split(AVL::SequenceNode<Value, RankInfo, Number> *node, Number index,
+               AVL::SequenceNode<Value, RankInfo, Number> **left,
+               AVL::SequenceNode<Value, RankInfo, Number> **right) {
+        if (!node) {
+            (*left) = NULL;
+            (*right) = NULL;
+            return;
+        }
+        this->Push(node);
+        const Number left_size = this->GetSize(node->left_child);
+        AVL::SequenceNode<Value, RankInfo, Number> *node_left = node->left_child;
+        AVL::SequenceNode<Value, RankInfo, Number> *node_right = node->right_child;
+        if (index <= left_size) {
+            AVL::SequenceNode<Value, RankInfo, Number> *rest;
+            this->Split(node_left, index, left, &rest);
+            (*right) = this->Join(rest, node, node_right);
+            return;
+        }
+        AVL::SequenceNode<Value, RankInfo, Number> *rest;
+        this->Split(node_right, index - left_size - 1, &rest, right);
+        (*left) = this->Join(node_left, node, rest);
+    }
+
+    AVL::SequenceNode<Value, RankInfo, Number> *FindIndexTraverse(Number index) {
+        AVL::SequenceNode<Value, RankInfo, Number> *node = this->root;
+        while (node) {
+            this->Push(node);
+            const Number left_size = this->GetSize(node->left_child);
+            if (index == left_size) {
+                return node;
+            }
+            if (index < left_size) {
+                node = node->left_child;
+            } else {
+                index -= (left_size + 1);
+                node = node->right_child;
+            }
+        }
+        return NULL;
+    }
+
+    void SetTraverse(AVL::SequenceNode<Value, RankInfo, Number> *node, Number index, const Value &value) {
+        this->Push(node);
+        const Number left_size = this->GetSize(node->left_child);
+        if (index < left_size) {
+            this->SetTraverse(node->left_child, index, value);
+        } else if (index > left_size) {
+            this->SetTraverse(node->right_child, index - left_size - 1, value);
+        } else {
+            node->value = value;
+        }
+        this->Update(node);
+    }
+
+    void Deallocation(AVL::SequenceNode<Value, RankInfo, Number> *node) {
+        if (!node) {
+            return;
+        }
+        this->Deallocation(node->left_child);
+        this->Deallocation(node->right_child);
+        delete node;
+    }
+
+    std::ostream &PrintInOrder(std::ostream &os, AVL::SequenceNode<Value, RankInfo, Number> *node, bool &first) {
+        if (!node) {
+            return os;
+        }
+        this->Push(node);
+        this->PrintInOrder(os, node->left_child, first);
+        if (!first) {
+            os << ", ";
+        }
+        first = false;
+        os << node->value;
+        this->PrintInOrder(os, node->right_child, first);
+        return os;
+    }
+
+    void CheckRange(Number first, Number last) const {
+        if (first < 0 || last > this->GetSize() || first > last) {
+            throw std::out_of_range("Range out of range.");
+        }
+    }
+
+public:
+    /**
+     * Constructor: Constructs an empty AVL sequence.
+     * @note Worst-Time Complexity: O(1).
+     */
+    AVLSequence() :
+            root(NULL) {}
+
+    AVLSequence(const AVLSequence &sequence) = delete;
+
+    AVLSequence &operator=(const AVLSequence &sequence) = delete;
+
+    /**
+     * Destructor: Deallocates the entire sequence.
+     * @note Worst-Time Complexity: O(n).
+     */
+    ~AVLSequence() {
+        this->Deallocation(this->root);
+    }
+
+    /**
+     * Gets the AVL sequence size.
+     * @note Worst-Time Complexity: O(1).
+     * @return {Number} Sequence size.
+     */
+    Number GetSize() const {
+        return this->GetSize(this->root);
+    }
+
+    /**
+     * Gets the AVL sequence height.
+     * @note Worst-Time Complexity: O(1).
+     * @return {Number} Sequence height.
+     */
+    Number GetHeight() const {
+        return this->GetHeight(this->root);
+    }
+
+    /**
+     * Gets the value at a given position.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param index - The element position.
+     * @return {Value} The element value.
+     */
+    Value Get(Number index) {
+        if (index < 0 || index >= this->GetSize()) {
+            throw std::out_of_range("Index out of range.");
+        }
+        return this->FindIndexTraverse(index)->value;
+    }
+
+    /**
+     * Sets the value at a given position.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param index - The element position.
+     * @param value - The new element value.
+     */
+    void Set(Number index, const Value value) {
+        if (index < 0 || index >= this->GetSize()) {
+            throw std::out_of_range("Index out of range.");
+        }
+        this->SetTraverse(this->root, index, value);
+    }
+
+    /**
+     * Inserts a value before a given position (index == size appends).
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param index - The new element position.
+     * @param value - The element value.
+     */
+    void InsertAt(Number index, const Value value) {
+        this->CheckRange(index, index);
+        AVL::SequenceNode<Value, RankInfo, Number> *left;
+        AVL::SequenceNode<Value, RankInfo, Number> *right;
+        this->Split(this->root, index, &left, &right);
+        this->root = this->Join(left, new AVL::SequenceNode<Value, RankInfo, Number>(value), right);
+    }
+
+    /**
+     * Removes the value at a given position.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param index - The element position.
+     * @return {bool} True if removed o.w False.
+     */
+    bool EraseAt(Number index) {
+        if (index < 0 || index >= this->GetSize()) {
+            return false;
+        }
+        AVL::SequenceNode<Value, RankInfo, Number> *left;
+        AVL::SequenceNode<Value, RankInfo, Number> *middle;
+        AVL::SequenceNode<Value, RankInfo, Number> *right;
+        this->Split(this->root, index, &left, &right);
+        this->Split(right, 1, &middle, &right);
+        delete middle;
+        this->root = this->Concat(left, right);
+        return true;
+    }
+
+    /**
+     * Moves the elements at positions [index, size) to the front of another sequence.
+     * @note Worst-Time Complexity: O(log(n) + log(m)).
+     * @note Splitting a sequence into itself leaves it unchanged (as ConcatSeq).
+     * @param index - The first moved position.
+     * @param tail - Receives the moved elements.
+     */
+    void SplitAt(Number index, AVL::AVLSequence<Value, Number, RankInfo> &tail) {
+        this->CheckRange(index, index);
+        if (&tail == this) {
+            return;
+        }
+        AVL::SequenceNode<Value, RankInfo, Number> *right;
+        this->Split(this->root, index, &this->root, &right);
+        tail.root = this->Concat(right, tail.root);
+    }
+
+    /**
+     * Moves every element of another sequence to the end of this sequence.
+     * @note Worst-Time Complexity: O(log(n) + log(m)).
+     * @param sequence - The appended sequence, left empty.
+     */
+    void ConcatSeq(AVL::AVLSequence<Value, Number, RankInfo> &sequence) {
+        if (&sequence == this) {
+            return;
+        }
+        this->root = this->Concat(this->root, sequence.root);
+        sequence.root = NULL;
+    }
+
+    /**
+     * Reverses the elements at positions [first, last) using a lazy flag.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param first - The first position.
+     * @param last - The position after the last element.
+     */
+    void Reverse(Number first, Number last) {
+        this->CheckRange(first, last);
+        AVL::SequenceNode<Value, RankInfo, Number> *left;
+        AVL::SequenceNode<Value, RankInfo, Number> *middle;
+        AVL::SequenceNode<Value, RankInfo, Number> *right;
+        this->Split(this->root, first, &left, &right);
+        this->Split(right, last - first, &middle, &right);
+        if (middle) {
+            middle->reversed = !middle->reversed;
+        }
+        this->root = this->Concat(this->Concat(left, middle), right);
+    }
+
+    /**
+     * Collect the rank information of the elements at positions [first, last) (e.g. range sum).
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param first - The first position.
+     * @param last - The position after the last element.
+     * @return {RankInfo} an object containing collective rank information.
+     */
+    RankInfo *CollectRank(Number first, Number last) {
+        this->CheckRange(first, last);
+        AVL::SequenceNode<Value, RankInfo, Number> *left;
+        AVL::SequenceNode<Value, RankInfo, Number> *middle;
+        AVL::SequenceNode<Value, RankInfo, Number> *right;
+        this->Split(this->root, first, &left, &right);
+        this->Split(right, last - first, &middle, &right);
+        RankInfo *rank = middle ? new RankInfo(middle->rank) : new RankInfo();
+        this->root = this->Concat(this->Concat(left, middle), right);
+        return rank;
+    }
+
+    /**
+     * Prints the entire sequence.
+     * @note Worst-Time Complexity: O(n).
+     */
+    std::ostream &PrintSequence(std::ostream &os) {
+        bool first = true;
+        os << "[";
+        this->PrintInOrder(os, this->root, first);
+        os << "]";
+        return os;
+    }
+};
+
+#endif
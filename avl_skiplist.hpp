@@ -0,0 +1,665 @@
+/**
+ * Lock-free indexable skip list, a concurrent counterpart of the Generic AVL (Balanced) Rank Tree.
+ *
+ * @file avl_skiplist.hpp
+ *
+ * @brief CAS linked skip list with per-level span counts (rank/select) and epoch based reclamation.
+ *
+ * @author Liav Barsheshet
+ * Contact: liavbarsheshet@gmail.com
+ *
+ * This implementation is free: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This implementation is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <atomic>
+#include <new>
+#include "avl.hpp"
+
+#ifndef _AVL_SKIPLIST_HPP
+#define _AVL_SKIPLIST_HPP
+
+namespace AVL {
+    template<typename Key, typename Value, typename Number = long long>
+    class SkipListNode;
+
+    template<typename Key, typename Value,
+            typename Number = long long,
+            class Compare = CompareFunc<Key>>
+    class ConcurrentSkipList;
+}
+
+/**
+ * Class: Represents nodes inside the Concurrent Skip List.
+ * The next pointers (low bit marks the node as deleted at that level) and the spans (amount of elements
+ * a link skips over) are allocated right after the node.
+ * @tparam Key - The type/class of the key.
+ * @tparam Value - The type/class of the value.
+ * @tparam Number - Class/Primitive for numbers representation.
+ */
+template<typename Key, typename Value, typename Number>
+class AVL::SkipListNode {
+public:
+    Key key;
+    Value value;
+    int height;
+    /* Chains the node in a retire list once it is unlinked. */
+    SkipListNode<Key, Value, Number> *retired_next;
+    std::atomic<uintptr_t> *next;
+    std::atomic<Number> *span;
+
+    static SkipListNode<Key, Value, Number> *Allocate(const Key &key, const Value &value, int height) {
+        void *memory = malloc(sizeof(SkipListNode<Key, Value, Number>) +
+                              height * (sizeof(std::atomic<uintptr_t>) + sizeof(std::atomic<Number>)));
+        if (!memory) {
+            throw std::bad_alloc();
+        }
+        SkipListNode<Key, Value, Number> *node = new(memory) SkipListNode<Key, Value, Number>(key, value, height);
+        node->next = reinterpret_cast<std::atomic<uintptr_t> *>(node + 1);
+        node->span = reinterpret_cast<std::atomic<Number> *>(node->next + height);
+        for (int level = 0; level < height; ++level) {
+            new(&node->next[level]) std::atomic<uintptr_t>(0);
+            new(&node->span[level]) std::atomic<Number>(0);
+        }
+        return node;
+    }
+
+    static void Deallocate(SkipListNode<Key, Value, Number> *node) {
+        node->~SkipListNode<Key, Value, Number>();
+        free(node);
+    }
+
+private:
+    SkipListNode(const Key &key, const Value &value, int height) :
+            key(key),
+            value(value),
+            height(height),
+            retired_next(NULL),
+            next(NULL),
+            span(NULL) {}
+};
+
+/**
+ * Class: Concurrent (Lock-Free) Indexable Skip List.
+ * Insert, Remove and Find are lock-free: nodes are linked with CAS and logically deleted by marking their
+ * next pointers, unlinked nodes are reclaimed once every thread that could still hold them has finished its
+ * operation (epoch based reclamation). Each link keeps a span count so GetIndexOfKey (rank) and FindIndex
+ * (select) run in expected O(log(n)).
+ * @note Membership is exact under any concurrency. Rank and select are quiescent-exact: exact when no writer is
+ * in progress during the call, approximate while writers run (a link split races with the span increments of the
+ * inserts under it). Overlapping writers mark the spans stale, and the next rank or select call that finds no
+ * writer in progress repairs them in O(n) first, so writers never pay for it.
+ * @note Keys are unique (Insert of an existing key fails).
+ * @note Every operation holds one of MAX_THREADS epoch slots. When all of them are held, further threads do not
+ * wait: they run slot-free, pinning the epoch through a shared counter (reclamation pauses meanwhile) and handing
+ * the nodes they remove to the next slot holder that retires a node.
+ * @tparam Key - The type/class of the key (default constructible).
+ * @tparam Value - The type/class of the value (default constructible).
+ * @tparam Number - Class/Primitive for numbers representation.
+ * @tparam Compare - Compare Function Object of the keys.
+ */
+template<typename Key, typename Value, typename Number, class Compare>
+class AVL::ConcurrentSkipList {
+public:
+    static const int MAX_LEVEL = 24;
+    static const size_t MAX_THREADS = 128;
+
+protected:
+    typedef AVL::SkipListNode<Key, Value, Number> ListNode;
+
+    static const uintptr_t MARK = 1;
+    static const unsigned ADVANCE_INTERVAL = 64;
+
+    /* Epoch slot held by a thread for the duration of an operation, owns its retire lists meanwhile. */
+    class EpochSlot {
+    public:
+        std::atomic<bool> active;
+        std::atomic<uint64_t> epoch;
+        ListNode *retired[3];
+        uint64_t tags[3];
+        unsigned retired_count;
+        char padding[64];
+
+        EpochSlot() :
+                active(false),
+                epoch(0),
+                retired(),
+                tags(),
+                retired_count(0) {}
+    };
+
+    class Guard {
+        AVL::ConcurrentSkipList<Key, Value, Number, Compare> &list;
+
+    public:
+        EpochSlot *slot;
+
+        explicit Guard(const AVL::ConcurrentSkipList<Key, Value, Number, Compare> &list) :
+                list(const_cast<AVL::ConcurrentSkipList<Key, Value, Number, Compare> &>(list)),
+                slot(this->list.Enter()) {}
+
+        ~Guard() {
+            if (this->slot) {
+                this->slot->active.store(false);
+            } else {
+                this->list.overflow.fetch_sub(1);
+            }
+        }
+    };
+
+    /* Counts a writer for the duration of an operation, marking the spans stale when writers overlap. */
+    class WriteGuard {
+        AVL::ConcurrentSkipList<Key, Value, Number, Compare> &list;
+
+    public:
+        explicit WriteGuard(AVL::ConcurrentSkipList<Key, Value, Number, Compare> &list) :
+                list(list) {
+            if (this->list.writers.fetch_add(1) != 0) {
+                this->list.spans_stale.store(true);
+            }
+            this->list.writes.fetch_add(1);
+        }
+
+        ~WriteGuard() {
+            this->list.writers.fetch_sub(1);
+        }
+    };
+
+    ListNode *head;
+    std::atomic<Number> size;
+    Compare compare;
+
+    EpochSlot *slots;
+    std::atomic<uint64_t> global_epoch;
+    /* Threads running without an epoch slot, the epoch does not advance while there are any. */
+    std::atomic<size_t> overflow;
+    /* Nodes removed by slot-free threads, adopted by the next slot holder that retires a node. */
+    std::atomic<ListNode *> orphans;
+
+    /* Writers in progress, writers started so far, and whether overlapping writers left the spans stale. */
+    std::atomic<size_t> writers;
+    std::atomic<uint64_t> writes;
+    std::atomic<bool> spans_stale;
+    std::atomic<bool> repairing;
+
+    static ListNode *Pointer(uintptr_t link) {
+        return reinterpret_cast<ListNode *>(link & ~MARK);
+    }
+
+    static bool Marked(uintptr_t link) {
+        return (link & MARK) != 0;
+    }
+
+    static uintptr_t Link(const ListNode *node) {
+        return reinterpret_cast<uintptr_t>(node);
+    }
+
+    static int RandomHeight() {
+        static thread_local uint64_t state = 0;
+        if (!state) {
+            state = reinterpret_cast<uintptr_t>(&state) ^ 0x9E3779B97F4A7C15ULL;
+        }
+        // xorshift64, each extra level with probability 1/2.
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        int height = 1;
+        for (uint64_t bits = state; (bits & 1) && height < MAX_LEVEL; bits >>= 1) {
+            ++height;
+        }
+        return height;
+    }
+
+    /** Epoch Based Reclamation */
+
+    static void FreeList(ListNode *node) {
+        while (node) {
+            ListNode *next = node->retired_next;
+            ListNode::Deallocate(node);
+            node = next;
+        }
+    }
+
+    /* Frees the retire lists of a slot whose grace period has passed. */
+    void Collect(EpochSlot *slot, uint64_t epoch) {
+        for (int i = 0; i < 3; ++i) {
+            if (slot->retired[i] && slot->tags[i] + 2 <= epoch) {
+                FreeList(slot->retired[i]);
+                slot->retired[i] = NULL;
+            }
+        }
+    }
+
+    /* Claims a free epoch slot, or returns NULL (slot-free, counted in overflow) if all MAX_THREADS are held. */
+    EpochSlot *Enter() {
+        static thread_local size_t hint = 0;
+        size_t i = hint;
+        for (size_t tries = 0; tries < MAX_THREADS; ++tries, i = (i + 1) % MAX_THREADS) {
+            bool expected = false;
+            if (!this->slots[i].active.load(std::memory_order_relaxed) &&
+                this->slots[i].active.compare_exchange_strong(expected, true)) {
+                hint = i;
+                EpochSlot *slot = &this->slots[i];
+                const uint64_t epoch = this->global_epoch.load();
+                slot->epoch.store(epoch);
+                this->Collect(slot, epoch);
+                return slot;
+            }
+        }
+        // Once counted, the epoch advances at most once more (an advance that checked before the count), so
+        // nothing this thread can reach is freed before it leaves.
+        this->overflow.fetch_add(1);
+        return NULL;
+    }
+
+    /* Advances the global epoch if every active thread has observed it. */
+    void TryAdvance() {
+        if (this->overflow.load() != 0) {
+            return;
+        }
+        uint64_t epoch = this->global_epoch.load();
+        for (size_t i = 0; i < MAX_THREADS; ++i) {
+            if (this->slots[i].active.load() && this->slots[i].epoch.load() != epoch) {
+                return;
+            }
+        }
+        this->global_epoch.compare_exchange_strong(epoch, epoch + 1);
+    }
+
+    /* Defers the deallocation of an unlinked node until no thread can hold it. */
+    void Retire(EpochSlot *slot, ListNode *node) {
+        if (!slot) {
+            node->retired_next = this->orphans.load();
+            while (!this->orphans.compare_exchange_weak(node->retired_next, node)) {
+            }
+            return;
+        }
+        const uint64_t epoch = this->global_epoch.load();
+        const int bucket = (int) (epoch % 3);
+        if (slot->tags[bucket] != epoch) {
+            // The bucket holds nodes retired at least 3 epochs ago.
+            FreeList(slot->retired[bucket]);
+            slot->retired[bucket] = NULL;
+            slot->tags[bucket] = epoch;
+        }
+        node->retired_next = slot->retired[bucket];
+        slot->retired[bucket] = node;
+        if (this->orphans.load(std::memory_order_relaxed)) {
+            // Retired again under the current epoch, which is not earlier than their removal.
+            ListNode *orphan = this->orphans.exchange(NULL);
+            while (orphan) {
+                ListNode *next = orphan->retired_next;
+                orphan->retired_next = slot->retired[bucket];
+                slot->retired[bucket] = orphan;
+                orphan = next;
+            }
+        }
+        if (++slot->retired_count % ADVANCE_INTERVAL == 0) {
+            this->TryAdvance();
+        }
+    }
+
+    /** Skip List */
+
+    /**
+     * Finds the predecessors and successors of a key on every level, unlinking marked nodes on the way.
+     * @param key - The searched key.
+     * @param preds - Receives the last node with a smaller key on each level.
+     * @param succs - Receives the following node on each level.
+     * @param positions - Receives the position of each predecessor (head is 0).
+     * @return {bool} True if an unmarked node with the key was found.
+     */
+    bool Search(const Key &key, ListNode **preds, ListNode **succs, Number *positions) {
+        retry:
+        ListNode *pred = this->head;
+        Number position = 0;
+        for (int level = MAX_LEVEL - 1; level >= 0; --level) {
+            ListNode *curr = Pointer(pred->next[level].load());
+            while (curr) {
+                uintptr_t succ = curr->next[level].load();
+                while (Marked(succ)) {
+                    uintptr_t expected = Link(curr);
+                    if (!pred->next[level].compare_exchange_strong(expected, succ & ~MARK)) {
+                        goto retry;
+                    }
+                    // The unlinked node's span merges into its predecessor (its own element is
+                    // accounted for by its remover).
+                    pred->span[level].fetch_add(curr->span[level].load());
+                    curr = Pointer(succ);
+                    if (!curr) {
+                        break;
+                    }
+                    succ = curr->next[level].load();
+                }
+                if (!curr || this->compare(curr->key, key) != LESS_THAN) {
+                    break;
+                }
+                position += pred->span[level].load();
+                pred = curr;
+                curr = Pointer(succ);
+            }
+            preds[level] = pred;
+            succs[level] = curr;
+            positions[level] = position;
+        }
+        return succs[0] && this->compare(succs[0]->key, key) == EQUAL;
+    }
+
+    /* Wait-free read-only descent, returns the last node with a smaller key on level 0. */
+    ListNode *ReadSearch(const Key &key, Number *position) const {
+        ListNode *pred = this->head;
+        Number pred_position = 0;
+        for (int level = MAX_LEVEL - 1; level >= 0; --level) {
+            ListNode *curr = Pointer(pred->next[level].load());
+            while (curr && this->compare(curr->key, key) == LESS_THAN) {
+                pred_position += pred->span[level].load();
+                pred = curr;
+                curr = Pointer(curr->next[level].load());
+            }
+        }
+        if (position) {
+            *position = pred_position;
+        }
+        return pred;
+    }
+
+    /* First unmarked node on level 0 after a node. */
+    static ListNode *NextLive(ListNode *node) {
+        ListNode *curr = Pointer(node->next[0].load());
+        while (curr && Marked(curr->next[0].load())) {
+            curr = Pointer(curr->next[0].load());
+        }
+        return curr;
+    }
+
+    /* Recomputes every span count from the level 0 order. */
+    void RebuildSpans() {
+        ListNode *last[MAX_LEVEL];
+        Number last_positions[MAX_LEVEL];
+        for (int level = 0; level < MAX_LEVEL; ++level) {
+            last[level] = this->head;
+            last_positions[level] = 0;
+        }
+        Number position = 0;
+        for (ListNode *node = NextLive(this->head); node; node = NextLive(node)) {
+            ++position;
+            for (int level = 0; level < node->height; ++level) {
+                last[level]->span[level].store(position - last_positions[level]);
+                last[level] = node;
+                last_positions[level] = position;
+            }
+        }
+        for (int level = 0; level < MAX_LEVEL; ++level) {
+            last[level]->span[level].store(position - last_positions[level]);
+        }
+    }
+
+    /*
+     * Rebuilds stale spans while no writer is in progress. A writer starting meanwhile leaves them stale for the
+     * next call, concurrent callers wait for the one rebuilding.
+     */
+    void RepairSpans() {
+        while (this->spans_stale.load() && this->writers.load() == 0) {
+            bool expected = false;
+            if (!this->repairing.compare_exchange_strong(expected, true)) {
+                continue;
+            }
+            const uint64_t writes = this->writes.load();
+            if (this->writers.load() == 0 && this->spans_stale.exchange(false)) {
+                this->RebuildSpans();
+                if (this->writers.load() != 0 || this->writes.load() != writes) {
+                    this->spans_stale.store(true);
+                }
+            }
+            this->repairing.store(false);
+        }
+    }
+
+public:
+    /**
+     * Constructor: Constructs an empty skip list.
+     * @note Worst-Time Complexity: O(MAX_THREADS).
+     */
+    ConcurrentSkipList() :
+            head(ListNode::Allocate(Key(), Value(), MAX_LEVEL)),
+            size(0),
+            compare(),
+            slots(new EpochSlot[MAX_THREADS]),
+            global_epoch(0),
+            overflow(0),
+            orphans(NULL),
+            writers(0),
+            writes(0),
+            spans_stale(false),
+            repairing(false) {}
+
+    ConcurrentSkipList(const ConcurrentSkipList &list) = delete;
+
+    ConcurrentSkipList &operator=(const ConcurrentSkipList &list) = delete;
+
+    /**
+     * Destructor: Deallocates the entire list (no thread may be inside the list).
+     * @note Worst-Time Complexity: O(n).
+     */
+    ~ConcurrentSkipList() {
+        ListNode *node = this->head;
+        while (node) {
+            ListNode *next = Pointer(node->next[0].load());
+            ListNode::Deallocate(node);
+            node = next;
+        }
+        for (size_t i = 0; i < MAX_THREADS; ++i) {
+            for (int j = 0; j < 3; ++j) {
+                FreeList(this->slots[i].retired[j]);
+            }
+        }
+        FreeList(this->orphans.load());
+        delete[] this->slots;
+    }
+
+    /**
+     * Gets the amount of elements.
+     * @note Worst-Time Complexity: O(1).
+     * @return {Number} Amount of elements (a snapshot under concurrency).
+     */
+    Number GetSize() const {
+        return this->size.load();
+    }
+
+    /**
+     * Inserts a new element.
+     * @note Expected-Time Complexity: O(log(n)), lock-free.
+     * @param key - The element key.
+     * @param value - The element value.
+     * @return {bool} True if inserted, False if the key already exists.
+     */
+    bool Insert(const Key key, const Value value) {
+        Guard guard(*this);
+        WriteGuard writer(*this);
+        ListNode *preds[MAX_LEVEL];
+        ListNode *succs[MAX_LEVEL];
+        Number positions[MAX_LEVEL];
+        const int height = RandomHeight();
+        ListNode *node = NULL;
+        while (true) {
+            if (this->Search(key, preds, succs, positions)) {
+                if (node) {
+                    ListNode::Deallocate(node);
+                }
+                return false;
+            }
+            if (!node) {
+                node = ListNode::Allocate(key, value, height);
+            }
+            for (int level = 0; level < height; ++level) {
+                node->next[level].store(Link(succs[level]));
+                // Distance to the successor once the node is placed at position positions[0] + 1.
+                node->span[level].store(preds[level]->span[level].load() - positions[0] + positions[level]);
+            }
+            uintptr_t expected = Link(succs[0]);
+            if (preds[0]->next[0].compare_exchange_strong(expected, Link(node))) {
+                preds[0]->span[0].store(1);
+                break;
+            }
+        }
+        this->size.fetch_add(1);
+
+        for (int level = 1; level < height; ++level) {
+            while (true) {
+                uintptr_t next = node->next[level].load();
+                if (Marked(next)) {
+                    // Removed while being linked, the remover's search unlinks it.
+                    goto linked;
+                }
+                if (Pointer(next) != succs[level] &&
+                    !node->next[level].compare_exchange_strong(next, Link(succs[level]))) {
+                    continue;
+                }
+                node->span[level].store(preds[level]->span[level].load() + 1 - (positions[0] + 1 - positions[level]));
+                uintptr_t expected = Link(succs[level]);
+                if (preds[level]->next[level].compare_exchange_strong(expected, Link(node))) {
+                    preds[level]->span[level].store(positions[0] + 1 - positions[level]);
+                    if (Marked(node->next[level].load())) {
+                        // A remover may have searched before this link, unlink it before the guard ends.
+                        this->Search(key, preds, succs, positions);
+                        goto linked;
+                    }
+                    break;
+                }
+                this->Search(key, preds, succs, positions);
+                // The node is linked on level 0, positions[0] is now its predecessor's position.
+                if (succs[0] != node) {
+                    goto linked;
+                }
+            }
+        }
+        linked:
+        for (int level = height; level < MAX_LEVEL; ++level) {
+            preds[level]->span[level].fetch_add(1);
+        }
+        return true;
+    }
+
+    /**
+     * Removes an element.
+     * @note Expected-Time Complexity: O(log(n)), lock-free.
+     * @param key - The element key.
+     * @return {bool} True if removed o.w False.
+     */
+    bool Remove(const Key key) {
+        Guard guard(*this);
+        WriteGuard writer(*this);
+        ListNode *preds[MAX_LEVEL];
+        ListNode *succs[MAX_LEVEL];
+        Number positions[MAX_LEVEL];
+        if (!this->Search(key, preds, succs, positions)) {
+            return false;
+        }
+        ListNode *node = succs[0];
+        for (int level = node->height - 1; level >= 1; --level) {
+            uintptr_t next = node->next[level].load();
+            while (!Marked(next) && !node->next[level].compare_exchange_weak(next, next | MARK)) {
+            }
+        }
+        uintptr_t next = node->next[0].load();
+        while (true) {
+            if (Marked(next)) {
+                // Another thread removed it first.
+                return false;
+            }
+            if (node->next[0].compare_exchange_weak(next, next | MARK)) {
+                break;
+            }
+        }
+        // Unlinks the node on every level, then drops its element from the links covering its position.
+        this->Search(key, preds, succs, positions);
+        for (int level = 0; level < MAX_LEVEL; ++level) {
+            preds[level]->span[level].fetch_sub(1);
+        }
+        this->size.fetch_sub(1);
+        this->Retire(guard.slot, node);
+        return true;
+    }
+
+    /**
+     * Find an element by its key.
+     * @note Expected-Time Complexity: O(log(n)), wait-free.
+     * @param key - The element key.
+     * @param value - Receives the element value.
+     * @return {bool} True if found o.w False.
+     */
+    bool Find(const Key key, Value &value) const {
+        Guard guard(*this);
+        ListNode *node = NextLive(this->ReadSearch(key, NULL));
+        if (!node || this->compare(node->key, key) != EQUAL) {
+            return false;
+        }
+        value = node->value;
+        return true;
+    }
+
+    /**
+     * Gets the index of a specific elements by key.
+     * @note Expected-Time Complexity: O(log(n)), plus O(n) once after overlapping writers (span repair).
+     * @note Exact when no writer is in progress during the call, approximate o.w (see the class notes).
+     * @param key - The element key.
+     * @return {Number} Index of an element as if it was in a sorted array, -1 if not found.
+     */
+    Number GetIndexOfKey(const Key key) {
+        Guard guard(*this);
+        this->RepairSpans();
+        Number position = 0;
+        ListNode *node = NextLive(this->ReadSearch(key, &position));
+        if (!node || this->compare(node->key, key) != EQUAL) {
+            return -1;
+        }
+        return position;
+    }
+
+    /**
+     * Find an element by its index.
+     * @note Expected-Time Complexity: O(log(n)), plus O(n) once after overlapping writers (span repair).
+     * @note Exact when no writer is in progress during the call, approximate o.w (see the class notes).
+     * @param index - The element index as if it was in a sorted array.
+     * @param key - Receives the element key.
+     * @param value - Receives the element value.
+     * @return {bool} True if the index is in range o.w False.
+     */
+    bool FindIndex(const Number index, Key &key, Value &value) {
+        if (index < 0) {
+            return false;
+        }
+        Guard guard(*this);
+        this->RepairSpans();
+        ListNode *node = this->head;
+        Number position = 0;
+        for (int level = MAX_LEVEL - 1; level >= 0; --level) {
+            ListNode *next = Pointer(node->next[level].load());
+            while (next && position + node->span[level].load() <= index + 1) {
+                position += node->span[level].load();
+                node = next;
+                next = Pointer(node->next[level].load());
+            }
+            if (position == index + 1) {
+                break;
+            }
+        }
+        if (node == this->head || position != index + 1) {
+            return false;
+        }
+        key = node->key;
+        value = node->value;
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,241 @@
+/**
+ * Self-adjusting (splay on access) mode of the Generic AVL (Balanced) Rank Tree.
+ *
+ * @file avl_splay.hpp
+ *
+ * @brief Rank tree whose lookups move the accessed node to the root, keeping rank information exact.
+ *
+ * @author Liav Barsheshet
+ * Contact: liavbarsheshet@gmail.com
+ *
+ * This implementation is free: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This implementation is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+#include "avl.hpp"
+
+#ifndef _AVL_SPLAY_HPP
+#define _AVL_SPLAY_HPP
+
+namespace AVL {
+    template<typename Key, typename Value,
+            typename Number = long long,
+            class RankInfo = DefaultRank<Key, Value, Number>,
+            class Compare = CompareFunc<Key>>
+    class SplayRankTree;
+}
+
+/**
+ * Class: Splay Rank Tree.
+ * Find, FindNode and Closest splay the accessed node (or the last node of an unsuccessful descent) to the root,
+ * so frequently accessed keys stay near the top.
+ * Every splay step is made of the tree rotations, which recompute heights and rank information, so ranks
+ * stay exact. Insertions and removals run the AVL ones, whose rebalancing only acts at a balance of +-2, so
+ * they do not bring a splayed tree back to AVL balance (Validate skips the balance check).
+ * @note Lookups are amortized O(log(n)), a single access may take O(n).
+ * @note The tree may get O(n) deep (e.g. sequential lookups), every inherited traversal is iterative.
+ * @note The rank tree is a protected base, so every lookup goes through this class, and the rest of the tree
+ * interface is re-exported (except the approximate rank mode). Find and FindNode of a const tree do not splay.
+ * @tparam Key - The type/class of the key.
+ * @tparam Value - The type/class of the value.
+ * @tparam Number - Class/Primitive for numbers representation.
+ * @tparam RankInfo - Class of rank information.
+ * @tparam Compare - Compare Function Object of the keys.
+ */
+template<typename Key, typename Value, typename Number, class RankInfo, class Compare>
+class AVL::SplayRankTree : protected AVL::AVLRankTree<Key, Value, Number, RankInfo, Compare> {
+    typedef AVL::AVLRankTree<Key, Value, Number, RankInfo, Compare> Tree;
+    typedef AVL::Node<Key, Value, RankInfo, Number> TreeNode;
+
+    /* Rotates a node above its parent. */
+    void RotateUp(TreeNode *node) {
+        TreeNode *parent = node->parent;
+        TreeNode *grandparent = parent->parent;
+        TreeNode *top = (parent->left_child == node ? this->RotateR(parent) : this->RotateL(parent));
+        this->ReplaceChild(grandparent, parent, top);
+    }
+
+    void Splay(TreeNode *node) {
+        if (!node) {
+            return;
+        }
+        while (node->parent) {
+            TreeNode *parent = node->parent;
+            TreeNode *grandparent = parent->parent;
+            if (!grandparent) {
+                // Zig.
+                this->RotateUp(node);
+            } else if ((grandparent->left_child == parent) == (parent->left_child == node)) {
+                // Zig-Zig.
+                this->RotateUp(parent);
+                this->RotateUp(node);
+            } else {
+                // Zig-Zag.
+                this->RotateUp(node);
+                this->RotateUp(node);
+            }
+        }
+    }
+
+    TreeNode *SplayFind(const Key &key) {
+        TreeNode *node = this->root;
+        TreeNode *last = NULL;
+        while (node) {
+            last = node;
+            const COMPARE_RESULT result = this->compare(key, node->key);
+            if (result == EQUAL) {
+                break;
+            }
+            node = (result == LESS_THAN ? node->left_child : node->right_child);
+        }
+        this->Splay(last);
+        return node;
+    }
+
+public:
+    using Tree::GetSize;
+    using Tree::GetHeight;
+    using Tree::GetIndexOfKey;
+    using Tree::CountLessThan;
+    using Tree::CountLessOrEqual;
+    using Tree::Find;
+    using Tree::FindNode;
+    using Tree::FindIndex;
+    using Tree::FindIndexNode;
+    using Tree::GetIndexOfNode;
+    using Tree::Next;
+    using Tree::Prev;
+    using Tree::GetMin;
+    using Tree::GetMax;
+    using Tree::Insert;
+    using Tree::InsertOrAssign;
+    using Tree::InsertNode;
+    using Tree::Update;
+    using Tree::ChangeKey;
+    using Tree::ChangeNodeKey;
+    using Tree::RemoveNode;
+    using Tree::CollectRank;
+    using Tree::Query;
+    using Tree::ParallelQuery;
+    using Tree::PartitionPoints;
+    using Tree::CollectRankBatch;
+    using Tree::QueryMultiRange;
+    using Tree::TopKInRange;
+    using Tree::Compact;
+    using Tree::Reserve;
+    using Tree::SetArenaPages;
+    using Tree::GetArenaPages;
+    using Tree::PrintTree;
+    using Tree::operator[];
+
+    /**
+     * Constructor: Constructs an empty splay rank tree.
+     * @note Worst-Time Complexity: O(1).
+     */
+    SplayRankTree() :
+            Tree() {}
+
+    SplayRankTree(const SplayRankTree &tree) = delete;
+
+    SplayRankTree &operator=(const SplayRankTree &tree) = delete;
+
+    /**
+     * Find an element by its key and splays it to the root.
+     * @note Amortized-Time Complexity: O(log(n)).
+     * @param key - The element key.
+     * @return {KeyValuePair<Key, Value>} element or NULL if not found.
+     */
+    AVL::KeyValuePair<Key, Value> *Find(const Key key) {
+        TreeNode *node = this->SplayFind(key);
+        if (!node) {
+            return NULL;
+        }
+        return new AVL::KeyValuePair<Key, Value>(node->key, node->value);
+    }
+
+    /**
+     * Find the node of an element by its key and splays it to the root.
+     * @note Amortized-Time Complexity: O(log(n)).
+     * @param key - The element key.
+     * @return {Node<Key, Value, RankInfo, Number>} node or NULL if not found.
+     */
+    TreeNode *FindNode(const Key key) {
+        return this->SplayFind(key);
+    }
+
+    /**
+     * Find the closest element to a specific key and splays it to the root.
+     * @note Amortized-Time Complexity: O(log(n)).
+     * @param key -  Key that defines the range.
+     * @param range - Defines which key closer to the key (LESS_THAN|GREATER_THAN) Default: LESS_THAN.
+     * @return {KeyValuePair<Key, Value>} element or NULL if not found.
+     */
+    AVL::KeyValuePair<Key, Value> *Closest(const Key key, COMPARE_RESULT range = LESS_THAN) {
+        if (range == EQUAL) {
+            return this->Find(key);
+        }
+        TreeNode *node = this->root;
+        TreeNode *last = NULL;
+        TreeNode *result_node = NULL;
+        while (node) {
+            last = node;
+            const COMPARE_RESULT result = this->compare(key, node->key);
+            if (result == EQUAL) {
+                result_node = node;
+                break;
+            }
+            if (result == LESS_THAN) {
+                if (range == GREATER_THAN) {
+                    result_node = node;
+                }
+                node = node->left_child;
+            } else {
+                if (range == LESS_THAN) {
+                    result_node = node;
+                }
+                node = node->right_child;
+            }
+        }
+        this->Splay(result_node ? result_node : last);
+        if (!result_node) {
+            return NULL;
+        }
+        return new AVL::KeyValuePair<Key, Value>(result_node->key, result_node->value);
+    }
+
+    /**
+     * Verifies every structural invariant of the tree except the AVL balance (see AVLRankTree::Validate).
+     * @note Worst-Time Complexity: O(n/threads + threads).
+     * @param threads - Amount of threads, including the calling one (Default: hardware concurrency).
+     * @param max_issues - Maximal amount of issues kept in the report (all issues are counted) (Default: 64).
+     * @return {ValidationReport<Key, Value, RankInfo, Number>} the report of the found issues.
+     */
+    AVL::ValidationReport<Key, Value, RankInfo, Number>
+    Validate(unsigned threads = std::thread::hardware_concurrency(), size_t max_issues = 64) const {
+        return this->ValidateTree(threads, max_issues, false);
+    }
+
+    /**
+     * Removes an element from the tree.
+     * @note Amortized-Time Complexity: O(log(n)).
+     * @param key - The element key.
+     * @return {bool} True if removed o.w False.
+     */
+    bool Remove(const Key key) {
+        TreeNode *node = this->SplayFind(key);
+        if (!node) {
+            return false;
+        }
+        this->RemoveNode(node);
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,301 @@
+/**
+ * String keys with an inline prefix for the Generic AVL (Balanced) Rank Tree.
+ *
+ * @file avl_string.hpp
+ *
+ * @brief Keys that compare an inline 8-byte prefix first, plus an interning arena owning the characters.
+ *
+ * @author Liav Barsheshet
+ * Contact: liavbarsheshet@gmail.com
+ *
+ * This implementation is free: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This implementation is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include "avl.hpp"
+
+#ifndef _AVL_STRING_HPP
+#define _AVL_STRING_HPP
+
+namespace AVL {
+    class StringKey;
+
+    class StringKeyCompare;
+
+    class StringKeyArena;
+
+    /* Type aliases of an AVL rank tree keyed by prefixed strings. */
+    template<typename Value, typename Number = long long,
+            class RankInfo = DefaultRank<StringKey, Value, Number>>
+    using StringRankTree = AVLRankTree<StringKey, Value, Number, RankInfo, StringKeyCompare>;
+}
+
+/**
+ * Class: Represents a string key which does not own its characters.
+ * The first 8 bytes are packed big-endian into an integer kept inside the key (and therefore inside the
+ * tree node), so most comparisons never touch the character buffer.
+ * @note The characters must outlive the key (see StringKeyArena).
+ */
+class AVL::StringKey {
+public:
+    /* The first 8 bytes, big-endian and zero padded. */
+    uint64_t prefix;
+    const char *data;
+    size_t length;
+
+    static uint64_t Prefix(const char *data, size_t length) {
+        uint64_t prefix = 0;
+        for (size_t i = 0; i < 8; ++i) {
+            prefix = (prefix << 8) | (i < length ? (uint64_t) (unsigned char) data[i] : 0);
+        }
+        return prefix;
+    }
+
+    StringKey() :
+            prefix(0),
+            data(""),
+            length(0) {}
+
+    StringKey(const char *data, size_t length) :
+            prefix(Prefix(data, length)),
+            data(data),
+            length(length) {}
+
+    explicit StringKey(const std::string &string) :
+            prefix(Prefix(string.data(), string.size())),
+            data(string.data()),
+            length(string.size()) {}
+
+    /**
+     * Three way lexicographic compare (bytes as unsigned).
+     * @param key - The other key.
+     * @return {int} Negative, zero or positive.
+     */
+    int Compare(const StringKey &key) const {
+        if (this->prefix != key.prefix) {
+            return this->prefix < key.prefix ? -1 : 1;
+        }
+        const size_t length = (this->length < key.length ? this->length : key.length);
+        if (length > 8) {
+            const int result = memcmp(this->data + 8, key.data + 8, length - 8);
+            if (result != 0) {
+                return result;
+            }
+        }
+        if (this->length == key.length) {
+            return 0;
+        }
+        return this->length < key.length ? -1 : 1;
+    }
+
+    bool operator<(const StringKey &key) const {
+        return this->Compare(key) < 0;
+    }
+
+    bool operator>(const StringKey &key) const {
+        return this->Compare(key) > 0;
+    }
+
+    bool operator==(const StringKey &key) const {
+        return this->Compare(key) == 0;
+    }
+
+    std::string ToString() const {
+        return std::string(this->data, this->length);
+    }
+
+    std::ostream &Print(std::ostream &os) const {
+        os.write(this->data, (std::streamsize) this->length);
+        return os;
+    }
+};
+
+inline std::ostream &operator<<(std::ostream &os, const AVL::StringKey &key) {
+    key.Print(os);
+    return os;
+}
+
+/**
+ * Class: String Key Compare Function.
+ * Compares the inline prefixes first and falls back to the characters only on prefix ties.
+ */
+class AVL::StringKeyCompare : public AVL::CompareFunc<AVL::StringKey> {
+public:
+    AVL::COMPARE_RESULT operator()(const AVL::StringKey key1, const AVL::StringKey key2) const {
+        const int result = key1.Compare(key2);
+        if (result < 0) {
+            return LESS_THAN;
+        }
+        if (result > 0) {
+            return GREATER_THAN;
+        }
+        return EQUAL;
+    }
+};
+
+/**
+ * Class: String Key Arena.
+ * Owns the characters of string keys in large append-only blocks instead of one heap buffer per key.
+ * With deduplication (interning) equal strings share the same characters.
+ * @note Keys are valid until the arena is destroyed.
+ */
+class AVL::StringKeyArena {
+    class Block {
+    public:
+        Block *next;
+        size_t used;
+        size_t capacity;
+
+        char *Data() {
+            return reinterpret_cast<char *>(this + 1);
+        }
+    };
+
+    static const size_t BLOCK_SIZE = 64 * 1024;
+
+    Block *blocks;
+    bool deduplicate;
+
+    /* Open addressing set of interned keys (data == NULL marks a free slot). */
+    AVL::StringKey *slots;
+    size_t slots_capacity;
+    size_t slots_used;
+
+    static uint64_t Hash(const char *data, size_t length) {
+        uint64_t hash = 1469598103934665603ULL;
+        for (size_t i = 0; i < length; ++i) {
+            hash = (hash ^ (unsigned char) data[i]) * 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    const char *Store(const char *data, size_t length) {
+        if (!this->blocks || this->blocks->capacity - this->blocks->used < length) {
+            const size_t capacity = (length > BLOCK_SIZE ? length : BLOCK_SIZE);
+            Block *block = static_cast<Block *>(malloc(sizeof(Block) + capacity));
+            if (!block) {
+                throw std::bad_alloc();
+            }
+            block->next = this->blocks;
+            block->used = 0;
+            block->capacity = capacity;
+            this->blocks = block;
+        }
+        char *result = this->blocks->Data() + this->blocks->used;
+        memcpy(result, data, length);
+        this->blocks->used += length;
+        return result;
+    }
+
+    size_t FindSlot(const AVL::StringKey *slots, size_t capacity, const char *data, size_t length,
+                    uint64_t hash) const {
+        size_t slot = (size_t) hash & (capacity - 1);
+        while (slots[slot].data) {
+            if (slots[slot].length == length && memcmp(slots[slot].data, data, length) == 0) {
+                return slot;
+            }
+            slot = (slot + 1) & (capacity - 1);
+        }
+        return slot;
+    }
+
+    void GrowSlots() {
+        const size_t capacity = (this->slots_capacity ? this->slots_capacity * 2 : 1024);
+        AVL::StringKey *slots = new AVL::StringKey[capacity];
+        for (size_t i = 0; i < capacity; ++i) {
+            slots[i].data = NULL;
+        }
+        for (size_t i = 0; i < this->slots_capacity; ++i) {
+            const AVL::StringKey &key = this->slots[i];
+            if (key.data) {
+                slots[this->FindSlot(slots, capacity, key.data, key.length, Hash(key.data, key.length))] = key;
+            }
+        }
+        delete[] this->slots;
+        this->slots = slots;
+        this->slots_capacity = capacity;
+    }
+
+public:
+    /**
+     * Constructor: Constructs an empty arena.
+     * @note Worst-Time Complexity: O(1).
+     * @param deduplicate - Intern equal strings into a single copy (Default: true).
+     */
+    explicit StringKeyArena(bool deduplicate = true) :
+            blocks(NULL),
+            deduplicate(deduplicate),
+            slots(NULL),
+            slots_capacity(0),
+            slots_used(0) {}
+
+    StringKeyArena(const StringKeyArena &arena) = delete;
+
+    StringKeyArena &operator=(const StringKeyArena &arena) = delete;
+
+    /**
+     * Destructor: Deallocates every block, invalidating every key of this arena.
+     * @note Worst-Time Complexity: O(blocks).
+     */
+    ~StringKeyArena() {
+        while (this->blocks) {
+            Block *next = this->blocks->next;
+            free(this->blocks);
+            this->blocks = next;
+        }
+        delete[] this->slots;
+    }
+
+    /**
+     * Copies (or finds the interned copy of) a string and returns a key referencing it.
+     * @note Worst-Time Complexity: O(length) expected.
+     * @param data - The characters.
+     * @param length - Amount of characters.
+     * @return {StringKey} A key whose characters are owned by the arena.
+     */
+    AVL::StringKey Intern(const char *data, size_t length) {
+        if (!this->deduplicate) {
+            return AVL::StringKey(this->Store(data, length), length);
+        }
+        if (2 * (this->slots_used + 1) > this->slots_capacity) {
+            this->GrowSlots();
+        }
+        const size_t slot = this->FindSlot(this->slots, this->slots_capacity, data, length, Hash(data, length));
+        if (!this->slots[slot].data) {
+            this->slots[slot] = AVL::StringKey(this->Store(data, length), length);
+            ++this->slots_used;
+        }
+        return this->slots[slot];
+    }
+
+    /**
+     * Copies (or finds the interned copy of) a string and returns a key referencing it.
+     * @note Worst-Time Complexity: O(length) expected.
+     * @param string - The string.
+     * @return {StringKey} A key whose characters are owned by the arena.
+     */
+    AVL::StringKey Intern(const std::string &string) {
+        return this->Intern(string.data(), string.size());
+    }
+
+    /**
+     * Gets the amount of distinct interned strings.
+     * @note Worst-Time Complexity: O(1).
+     * @return {size_t} Amount of strings (0 without deduplication).
+     */
+    size_t GetInternedCount() const {
+        return this->slots_used;
+    }
+};
+
+#endif
@@ -0,0 +1,147 @@
+/**
+ * Sliding time-window order statistics built on top of the Generic AVL (Balanced) Rank Tree.
+ *
+ * @file avl_windowed.hpp
+ *
+ * @brief Rolling rank/quantile queries over the samples of the last time window.
+ *
+ * @author Liav Barsheshet
+ * Contact: liavbarsheshet@gmail.com
+ *
+ * This implementation is free: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This implementation is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+#include <deque>
+#include "avl.hpp"
+
+#ifndef _AVL_WINDOWED_HPP
+#define _AVL_WINDOWED_HPP
+
+namespace AVL {
+    template<typename Sample, typename Timestamp,
+            typename Number = long long,
+            class Compare = CompareFunc<Sample>>
+    class WindowedRankTree;
+}
+
+/**
+ * Class: Windowed Rank Tree.
+ * Keeps the samples of the last time window ordered by value (duplicates allowed).
+ * Samples are also kept in arrival order as a FIFO of node handles, so eviction never searches the tree.
+ * @note Samples must be ingested in non decreasing timestamp order.
+ * @tparam Sample - The type/class of the sample value.
+ * @tparam Timestamp - The type/class of the sample timestamp.
+ * @tparam Number - Class/Primitive for numbers representation.
+ * @tparam Compare - Compare Function Object of the sample values.
+ */
+template<typename Sample, typename Timestamp, typename Number, class Compare>
+class AVL::WindowedRankTree {
+    typedef AVL::DefaultRank<Sample, Timestamp, Number> TreeRank;
+    typedef AVL::Node<Sample, Timestamp, TreeRank, Number> TreeNode;
+
+    AVL::AVLRankTree<Sample, Timestamp, Number, TreeRank, Compare> tree;
+    std::deque<TreeNode *> arrivals;
+    Timestamp window;
+
+public:
+    /**
+     * Constructor: Constructs an empty windowed rank tree.
+     * @note Worst-Time Complexity: O(1).
+     * @param window - Length of the time window, samples older than (now - window) are evicted.
+     */
+    explicit WindowedRankTree(Timestamp window) :
+            tree(),
+            arrivals(),
+            window(window) {}
+
+    WindowedRankTree(const WindowedRankTree &tree) = delete;
+
+    WindowedRankTree &operator=(const WindowedRankTree &tree) = delete;
+
+    /**
+     * Gets the amount of samples currently in the window.
+     * @note Worst-Time Complexity: O(1).
+     * @return {Number} Amount of samples.
+     */
+    Number GetSize() const {
+        return this->tree.GetSize();
+    }
+
+    /**
+     * Adds a new sample.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param timestamp - The sample timestamp (not older than the last ingested sample).
+     * @param sample - The sample value.
+     */
+    void Ingest(const Timestamp timestamp, const Sample sample) {
+        this->arrivals.push_back(this->tree.InsertNode(sample, timestamp));
+    }
+
+    /**
+     * Evicts every sample whose timestamp is not within the window ending at a given time.
+     * @note Worst-Time Complexity: O(k*log(n)) - k=evicted samples.
+     * @param now - The current time.
+     * @return {Number} Amount of evicted samples.
+     */
+    Number Evict(const Timestamp now) {
+        Number evicted = 0;
+        while (!this->arrivals.empty() && !(now < this->arrivals.front()->value + this->window)) {
+            this->tree.RemoveNode(this->arrivals.front());
+            this->arrivals.pop_front();
+            ++evicted;
+        }
+        return evicted;
+    }
+
+    /**
+     * Gets the rank of a value among the samples in the window.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param sample - The value.
+     * @return {Number} Amount of samples less than the given value.
+     */
+    Number Rank(const Sample &sample) const {
+        return this->tree.CountLessThan(sample);
+    }
+
+    /**
+     * Gets the sample at a given quantile (nearest rank, rounded down).
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param quantile - Quantile in the range [0, 1], 0.5 is the median.
+     * @param sample - Receives the sample value.
+     * @return {bool} True if the window is not empty o.w False.
+     */
+    bool Quantile(double quantile, Sample &sample) const {
+        const Number size = this->tree.GetSize();
+        if (size == 0) {
+            return false;
+        }
+        if (quantile < 0) {
+            quantile = 0;
+        }
+        if (quantile > 1) {
+            quantile = 1;
+        }
+        sample = this->tree.FindIndexNode((Number) (quantile * (double) (size - 1)))->key;
+        return true;
+    }
+
+    /**
+     * Gets the median sample.
+     * @note Worst-Time Complexity: O(log(n)).
+     * @param sample - Receives the sample value.
+     * @return {bool} True if the window is not empty o.w False.
+     */
+    bool Median(Sample &sample) const {
+        return this->Quantile(0.5, sample);
+    }
+};
+
+#endif
@@ -0,0 +1,95 @@
+/**
+ * Approximate rank mode benchmark: insertion and removal throughput against the observed rank error, per bound.
+ *
+ * g++ -std=c++11 -O2 -pthread -I. bench/bench_approx_rank.cpp -o bench_approx_rank && ./bench_approx_rank [elements]
+ */
+
+#include "../avl.hpp"
+#include "bench_util.hpp"
+
+/* Exact ranks of the present keys (Fenwick tree over the key space), to measure the error of the tree. */
+class ExactRanks {
+private:
+    std::vector<long long> counts;
+
+public:
+    explicit ExactRanks(size_t keys) :
+            counts(keys + 1, 0) {}
+
+    void Add(int key, long long delta) {
+        for (size_t i = (size_t) key + 1; i < this->counts.size(); i += i & (0 - i)) {
+            this->counts[i] += delta;
+        }
+    }
+
+    /* Amount of present keys less than key. */
+    long long Rank(int key) const {
+        long long rank = 0;
+        for (size_t i = (size_t) key; i > 0; i -= i & (0 - i)) {
+            rank += this->counts[i];
+        }
+        return rank;
+    }
+};
+
+static void Run(long long bound, std::vector<int> keys, const std::vector<int> &churn) {
+    const size_t half = keys.size() / 2;
+    AVL::AVLRankTree<int, int> tree;
+    tree.SetRankErrorBound(bound);
+    printf("bound %lld\n", bound);
+
+    // Ascending keys: the descent stays in cache, so the ancestor updates are a large share of an insertion.
+    AVLBench::Timer append;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        tree.Insert((int) i, (int) i);
+    }
+    AVLBench::Report("  ascending insert", keys.size(), append.Seconds());
+    AVLBench::Timer trim;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        tree.Remove((int) i);
+    }
+    AVLBench::Report("  ascending remove", keys.size(), trim.Seconds());
+
+    // Random churn: every step removes a present key and inserts an absent one, the size stays at half the keys.
+    for (size_t i = 0; i < half; ++i) {
+        tree.Insert(keys[i], keys[i]);
+    }
+    AVLBench::Timer timer;
+    for (size_t i = 0; i < churn.size(); ++i) {
+        const size_t slot = (size_t) churn[i] % half;
+        tree.Remove(keys[slot]);
+        tree.Insert(keys[half + slot], keys[half + slot]);
+        std::swap(keys[slot], keys[half + slot]);
+    }
+    AVLBench::Report("  random remove+insert", churn.size() * 2, timer.Seconds());
+
+    ExactRanks exact(keys.size());
+    for (size_t i = 0; i < half; ++i) {
+        exact.Add(keys[i], 1);
+    }
+    long long max_error = 0;
+    double total_error = 0;
+    const size_t samples = std::min(half, (size_t) 100000);
+    for (size_t i = 0; i < samples; ++i) {
+        const int key = keys[(i * 7919) % half];
+        long long error = tree.GetIndexOfKey(key) - exact.Rank(key);
+        error = error < 0 ? -error : error;
+        max_error = std::max(max_error, error);
+        total_error += (double) error;
+    }
+    AVLBench::Timer flush;
+    tree.FlushRanks();
+    printf("  GetIndexOfKey error: max %lld, mean %.2f, then FlushRanks %.3f ms\n", max_error,
+           total_error / (double) samples, flush.Seconds() * 1e3);
+}
+
+int main(int argc, char **argv) {
+    const size_t count = std::max(AVLBench::ArgCount(argc, argv, 1000000), (size_t) 2);
+    const std::vector<int> keys = AVLBench::ShuffledKeys(count, 1);
+    const std::vector<int> churn = AVLBench::ShuffledKeys(count, 2);
+    const long long bounds[] = {0, 16, 256, 4096, 65536};
+    for (int i = 0; i < 5; ++i) {
+        Run(bounds[i], keys, churn);
+    }
+    return 0;
+}
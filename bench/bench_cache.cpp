@@ -0,0 +1,60 @@
+/**
+ * Cached rank tree benchmark: Zipf distributed lookups against AVLRankTree, then concurrent readers.
+ *
+ * g++ -std=c++11 -O2 -pthread -I. bench/bench_cache.cpp -o bench_cache && ./bench_cache [elements]
+ */
+
+#include <thread>
+#include "../avl_cache.hpp"
+#include "bench_util.hpp"
+
+template<class Tree>
+static double Lookups(const Tree &tree, const std::vector<int> &keys) {
+    AVLBench::Timer timer;
+    long long sum = 0;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        sum += tree.FindNode(keys[i])->value;
+    }
+    AVLBench::Keep(sum);
+    return timer.Seconds();
+}
+
+int main(int argc, char **argv) {
+    const size_t count = AVLBench::ArgCount(argc, argv, 1000000);
+    const std::vector<int> keys = AVLBench::ShuffledKeys(count, 1);
+    AVL::AVLRankTree<int, int> plain;
+    AVL::CachedRankTree<int, int> cached(4096);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        plain.Insert(keys[i], keys[i]);
+        cached.Insert(keys[i], keys[i]);
+    }
+    const double exponents[] = {0.8, 1.0, 1.2};
+    for (int i = 0; i < 3; ++i) {
+        const std::vector<int> lookups = AVLBench::ZipfKeys(count, 2000000, exponents[i], 2);
+        char name[64];
+        snprintf(name, sizeof(name), "zipf %.1f AVLRankTree::FindNode", exponents[i]);
+        AVLBench::Report(name, lookups.size(), Lookups(plain, lookups));
+        cached.ResetCacheStats();
+        snprintf(name, sizeof(name), "zipf %.1f CachedRankTree::FindNode", exponents[i]);
+        AVLBench::Report(name, lookups.size(), Lookups(cached, lookups));
+        printf("  hit rate %.1f%%\n", 100.0 * cached.GetCacheHits() / (double) lookups.size());
+    }
+    // Concurrent readers, each counting its hits and misses in its own shard.
+    const std::vector<int> lookups = AVLBench::ZipfKeys(count, 1000000, 1.0, 3);
+    for (unsigned threads = 1; threads <= 8; threads *= 2) {
+        std::vector<std::thread> workers;
+        AVLBench::Timer timer;
+        for (unsigned t = 0; t < threads; ++t) {
+            workers.push_back(std::thread([&cached, &lookups]() {
+                Lookups(cached, lookups);
+            }));
+        }
+        for (size_t t = 0; t < workers.size(); ++t) {
+            workers[t].join();
+        }
+        char name[64];
+        snprintf(name, sizeof(name), "zipf 1.0 CachedRankTree, %u threads", threads);
+        AVLBench::Report(name, lookups.size() * threads, timer.Seconds());
+    }
+    return 0;
+}
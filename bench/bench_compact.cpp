@@ -0,0 +1,67 @@
+/**
+ * Compact tree benchmark: memory and random lookups per second of CompactAVLTree against AVLRankTree, for
+ * int32 keys and values at 100M entries.
+ *
+ * g++ -std=c++11 -O2 -pthread -I. bench/bench_compact.cpp -o bench_compact && ./bench_compact [elements]
+ *
+ * 100M entries take about 2 GB in CompactAVLTree and 5.5 GB in AVLRankTree; pass a smaller count if needed.
+ */
+
+#include <stdint.h>
+#include "../avl_compact.hpp"
+#include "bench_util.hpp"
+
+template<class Tree>
+static void Run(const char *name, Tree &tree, size_t count, const std::vector<int> &keys) {
+    const unsigned bits = AVLBench::KeyBits(count);
+    const long long resident = AVLBench::ResidentBytes();
+    tree.Reserve((long long) count);
+    AVLBench::Timer build;
+    for (size_t i = 0; i < count; ++i) {
+        tree.Insert((int32_t) AVLBench::PermutedKey(i, bits), (int32_t) i);
+    }
+    printf("%s: %.1f bytes per entry (resident), built in %.1f s\n", name,
+           (double) (AVLBench::ResidentBytes() - resident) / (double) count, build.Seconds());
+
+    AVLBench::Timer find;
+    long long sum = 0;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        int32_t value = 0;
+        sum += tree.Find(keys[i], value) ? value : 0;
+    }
+    AVLBench::Report("  Find", keys.size(), find.Seconds());
+    AVLBench::Timer rank;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        sum += tree.GetIndexOfKey(keys[i]);
+    }
+    AVLBench::Report("  GetIndexOfKey", keys.size(), rank.Seconds());
+    AVLBench::Keep(sum);
+}
+
+/* AVLRankTree with the Find signature of CompactAVLTree. */
+class RankTree : public AVL::AVLRankTree<int32_t, int32_t> {
+public:
+    bool Find(const int32_t &key, int32_t &value) const {
+        const AVL::Node<int32_t, int32_t, AVL::DefaultRank<int32_t, int32_t>> *node = this->FindNode(key);
+        if (!node) {
+            return false;
+        }
+        value = node->value;
+        return true;
+    }
+};
+
+int main(int argc, char **argv) {
+    const size_t count = std::max(AVLBench::ArgCount(argc, argv, 100000000), (size_t) 1);
+    const std::vector<int> keys = AVLBench::PermutedDraws(count, 4000000, 1);
+    {
+        AVL::CompactAVLTree<int32_t, int32_t> compact;
+        Run("CompactAVLTree", compact, count, keys);
+        printf("  node array %.1f bytes per entry\n", (double) compact.GetMemoryUsage() / (double) count);
+    }
+    {
+        RankTree tree;
+        Run("AVLRankTree", tree, count, keys);
+    }
+    return 0;
+}
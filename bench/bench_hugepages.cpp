@@ -0,0 +1,122 @@
+/**
+ * Huge page benchmark: dTLB load misses and cold cache FindNode latency with the node arena on default,
+ * transparent huge and explicit huge pages.
+ *
+ * g++ -std=c++11 -O2 -pthread -I. bench/bench_hugepages.cpp -o bench_hugepages && ./bench_hugepages [elements]
+ *
+ * The dTLB counter uses perf_event_open (Linux, needs kernel.perf_event_paranoid <= 2 or CAP_PERFMON) and is
+ * reported as unavailable otherwise. Explicit huge pages need reserved pages (vm.nr_hugepages).
+ */
+
+#include <string.h>
+#include "../avl.hpp"
+#include "bench_util.hpp"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/* Counts the data TLB load misses of this thread in user space, or reports -1 where not available. */
+class TlbMissCounter {
+private:
+    int fd;
+
+public:
+    TlbMissCounter() :
+            fd(-1) {
+#if defined(__linux__)
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        this->fd = (int) syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+    }
+
+    ~TlbMissCounter() {
+#if defined(__linux__)
+        if (this->fd >= 0) {
+            close(this->fd);
+        }
+#endif
+    }
+
+    void Start() {
+#if defined(__linux__)
+        if (this->fd >= 0) {
+            ioctl(this->fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(this->fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    long long Stop() {
+        long long count = -1;
+#if defined(__linux__)
+        if (this->fd >= 0) {
+            ioctl(this->fd, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(this->fd, &count, sizeof(count)) != (ssize_t) sizeof(count)) {
+                count = -1;
+            }
+        }
+#endif
+        return count;
+    }
+};
+
+static const char *PagesName(AVL::ARENA_PAGES pages) {
+    switch (pages) {
+        case AVL::TRANSPARENT_HUGE_PAGES:
+            return "transparent huge pages";
+        case AVL::EXPLICIT_HUGE_PAGES:
+            return "explicit huge pages";
+        default:
+            return "default pages";
+    }
+}
+
+static void Run(AVL::ARENA_PAGES pages, size_t count, const std::vector<int> &keys) {
+    const unsigned bits = AVLBench::KeyBits(count);
+    AVL::AVLRankTree<int, int> tree;
+    tree.SetArenaPages(pages);
+    tree.Reserve((long long) count);
+    for (size_t i = 0; i < count; ++i) {
+        tree.Insert(AVLBench::PermutedKey(i, bits), (int) i);
+    }
+    printf("%s requested, %s obtained\n", PagesName(pages), PagesName(tree.GetArenaPages()));
+
+    TlbMissCounter misses;
+    AVLBench::EvictCaches();
+    misses.Start();
+    AVLBench::Timer find;
+    long long sum = 0;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        sum += tree.FindNode(keys[i])->value;
+    }
+    const double seconds = find.Seconds();
+    const long long tlb_misses = misses.Stop();
+    AVLBench::Keep(sum);
+    AVLBench::Report("  FindNode", keys.size(), seconds);
+    if (tlb_misses >= 0) {
+        printf("  dTLB load misses %.2f per FindNode\n", (double) tlb_misses / (double) keys.size());
+    } else {
+        printf("  dTLB load misses unavailable (perf_event_open)\n");
+    }
+}
+
+int main(int argc, char **argv) {
+    const size_t count = std::max(AVLBench::ArgCount(argc, argv, 10000000), (size_t) 1);
+    const std::vector<int> keys = AVLBench::PermutedDraws(count, 2000000, 1);
+    Run(AVL::DEFAULT_PAGES, count, keys);
+    Run(AVL::TRANSPARENT_HUGE_PAGES, count, keys);
+    Run(AVL::EXPLICIT_HUGE_PAGES, count, keys);
+    return 0;
+}
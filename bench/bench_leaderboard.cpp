@@ -0,0 +1,77 @@
+/**
+ * Leaderboard benchmark: 50M players, then score updates paced at 100k per second interleaved with rank reads.
+ *
+ * g++ -std=c++11 -O2 -pthread -I. bench/bench_leaderboard.cpp -o bench_leaderboard && ./bench_leaderboard [players]
+ *
+ * Players take roughly 150 bytes each (7.5 GB at 50M, tree plus id index); pass a smaller count on smaller machines.
+ */
+
+#include "../avl_leaderboard.hpp"
+#include "bench_util.hpp"
+
+/* Latency percentile of sorted samples, in microseconds. */
+static double Percentile(const std::vector<double> &sorted, double fraction) {
+    return sorted[(size_t) (fraction * (double) (sorted.size() - 1))] * 1e6;
+}
+
+int main(int argc, char **argv) {
+    const size_t players = std::max(AVLBench::ArgCount(argc, argv, 50000000), (size_t) 1);
+    const int max_score = 1000000;
+    std::mt19937_64 rng(1);
+    AVL::Leaderboard<long long, int> board;
+    board.Reserve((long long) players);
+
+    AVLBench::Timer build;
+    for (size_t id = 0; id < players; ++id) {
+        board.SetScore((long long) id, (int) (rng() % max_score));
+    }
+    AVLBench::Report("register players", players, build.Seconds());
+
+    // Unpaced: the update rate the leaderboard sustains on one thread.
+    const size_t updates = 1000000;
+    AVLBench::Timer unpaced;
+    for (size_t i = 0; i < updates; ++i) {
+        board.SetScore((long long) (rng() % players), (int) (rng() % max_score));
+    }
+    const double seconds = unpaced.Seconds();
+    AVLBench::Report("SetScore (unpaced)", updates, seconds);
+    printf("  sustainable %.0f updates/s on one thread (target 100000)\n", (double) updates / seconds);
+
+    // Paced: 100 updates every millisecond for 2 seconds, each batch followed by a RankOf and an AroundMe(10).
+    const int rate = 100000;
+    const int batch = rate / 1000;
+    const int batches = 2000;
+    std::vector<double> latencies;
+    latencies.reserve((size_t) batch * batches);
+    AVL::LeaderboardEntry<long long, int> rows[21];
+    long long sum = 0;
+    AVLBench::Timer paced;
+    for (int b = 0; b < batches; ++b) {
+        for (int i = 0; i < batch; ++i) {
+            AVLBench::Timer update;
+            board.SetScore((long long) (rng() % players), (int) (rng() % max_score));
+            latencies.push_back(update.Seconds());
+        }
+        const long long id = (long long) (rng() % players);
+        sum += board.RankOf(id) + board.AroundMe(id, 10, rows);
+        while (paced.Seconds() < (b + 1) * 1e-3) {
+        }
+    }
+    const double elapsed = paced.Seconds();
+    std::sort(latencies.begin(), latencies.end());
+    printf("paced %d updates/s for %.2f s (target 2.00 s): SetScore p50 %.2f us, p99 %.2f us, max %.2f us\n", rate,
+           elapsed, Percentile(latencies, 0.5), Percentile(latencies, 0.99), latencies.back() * 1e6);
+
+    AVLBench::Timer top;
+    for (int i = 0; i < 1000; ++i) {
+        sum += board.TopK(20, rows);
+    }
+    AVLBench::Report("TopK(20)", 1000, top.Seconds());
+    AVLBench::Timer page;
+    for (int i = 0; i < 1000; ++i) {
+        sum += board.Page((long long) (rng() % players), 20, rows);
+    }
+    AVLBench::Report("Page(random, 20)", 1000, page.Seconds());
+    AVLBench::Keep(sum);
+    return 0;
+}
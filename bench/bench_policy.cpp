@@ -0,0 +1,45 @@
+/**
+ * Tree policy benchmark: node size and insert/find/remove throughput of every policy configuration.
+ *
+ * g++ -std=c++11 -O2 -pthread -I. bench/bench_policy.cpp -o bench_policy && ./bench_policy [elements]
+ */
+
+#include "../avl_policy.hpp"
+#include "bench_util.hpp"
+
+template<class Policy>
+void Run(const char *name, const std::vector<int> &keys) {
+    typedef AVL::Node<int, int, AVL::DefaultRank<int, int>, long long, Policy> TreeNode;
+    AVL::AVLPolicyTree<int, int, Policy> tree;
+    printf("%s: %u node bytes\n", name, (unsigned) sizeof(TreeNode));
+
+    AVLBench::Timer insert;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        tree.Insert(keys[i], keys[i]);
+    }
+    AVLBench::Report("  insert", keys.size(), insert.Seconds());
+
+    AVLBench::Timer find;
+    long long found = 0;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        found += tree.FindNode(keys[i])->value;
+    }
+    AVLBench::Keep(found);
+    AVLBench::Report("  find", keys.size(), find.Seconds());
+
+    AVLBench::Timer remove;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        tree.Remove(keys[i]);
+    }
+    AVLBench::Report("  remove", keys.size(), remove.Seconds());
+}
+
+int main(int argc, char **argv) {
+    const std::vector<int> keys = AVLBench::ShuffledKeys(AVLBench::ArgCount(argc, argv, 1000000), 1);
+    Run<AVL::OrderedMapPolicy>("OrderedMapPolicy", keys);
+    Run<AVL::TreePolicy<true, false, false, false> >("parent pointers only", keys);
+    Run<AVL::TreePolicy<false, false, true, false> >("rank information only", keys);
+    Run<AVL::RankTreePolicy>("RankTreePolicy (AVLRankTree)", keys);
+    Run<AVL::TreePolicy<true, true, true, true> >("RankTreePolicy + operation stats", keys);
+    return 0;
+}
@@ -0,0 +1,59 @@
+/**
+ * Prefetch benchmark: cold cache FindNode and GetIndexOfKey latency from 10M to 500M entries. Build it twice to
+ * compare, with and without AVL_ENABLE_PREFETCH:
+ *
+ * g++ -std=c++11 -O2 -pthread -I. bench/bench_prefetch.cpp -o bench_prefetch && ./bench_prefetch [max elements]
+ * g++ -std=c++11 -O2 -pthread -DAVL_ENABLE_PREFETCH -I. bench/bench_prefetch.cpp -o bench_prefetch_on &&
+ *     ./bench_prefetch_on [max elements]
+ *
+ * Sizes above the given maximum (default 500M) are skipped; the tree takes roughly 55 bytes per entry (27 GB at
+ * 500M).
+ */
+
+#include "../avl.hpp"
+#include "bench_util.hpp"
+
+static void Run(size_t count) {
+    const unsigned bits = AVLBench::KeyBits(count);
+    AVL::AVLRankTree<int, int> tree;
+    tree.Reserve((long long) count);
+    AVLBench::Timer build;
+    for (size_t i = 0; i < count; ++i) {
+        tree.Insert(AVLBench::PermutedKey(i, bits), (int) i);
+    }
+    printf("%zu entries (built in %.1f s)\n", count, build.Seconds());
+
+    const size_t draws = 2000000;
+    const std::vector<int> keys = AVLBench::PermutedDraws(count, draws, 1);
+
+    AVLBench::EvictCaches();
+    AVLBench::Timer find;
+    long long sum = 0;
+    for (size_t i = 0; i < draws; ++i) {
+        sum += tree.FindNode(keys[i])->value;
+    }
+    AVLBench::Report("  FindNode", draws, find.Seconds());
+
+    AVLBench::EvictCaches();
+    AVLBench::Timer rank;
+    for (size_t i = 0; i < draws; ++i) {
+        sum += tree.GetIndexOfKey(keys[i]);
+    }
+    AVLBench::Report("  GetIndexOfKey", draws, rank.Seconds());
+    AVLBench::Keep(sum);
+}
+
+int main(int argc, char **argv) {
+    const size_t limit = AVLBench::ArgCount(argc, argv, 500000000);
+    const size_t sizes[] = {10000000, 50000000, 100000000, 500000000};
+    printf("prefetch %s\n", AVL_PREFETCH_ENABLED ? "on" : "off");
+    for (int i = 0; i < 4; ++i) {
+        if (sizes[i] <= limit) {
+            Run(sizes[i]);
+        }
+    }
+    if (limit < sizes[0]) {
+        Run(limit);
+    }
+    return 0;
+}
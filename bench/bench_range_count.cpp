@@ -0,0 +1,68 @@
+/**
+ * 2D range counting benchmark: bulk build of RangeCountIndex from a tree snapshot, and Count throughput against
+ * a scan of the key range.
+ *
+ * g++ -std=c++11 -O2 -pthread -I. bench/bench_range_count.cpp -o bench_range_count && ./bench_range_count [elements]
+ */
+
+#include "../avl_range_count.hpp"
+#include "bench_util.hpp"
+
+static int Attribute(int key, int value) {
+    (void) key;
+    return value;
+}
+
+/* Distinct keys mapped to attributes in [0, distinct). */
+static void Run(const std::vector<int> &keys, int distinct) {
+    AVL::AVLRankTree<int, int> tree;
+    std::mt19937 rng(2);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        tree.Insert(keys[i], (int) (rng() % (unsigned) distinct));
+    }
+    printf("%zu elements, %d distinct attributes\n", keys.size(), distinct);
+
+    AVLBench::Timer build;
+    AVL::RangeCountIndex<int, int, int> index(tree, Attribute);
+    AVLBench::Report("  bulk build", keys.size(), build.Seconds());
+
+    // Key ranges of 1% of the elements, attribute ranges of half the attributes.
+    const int span = std::max((int) (keys.size() / 100), 1);
+    const size_t queries = 200000;
+    std::vector<int> starts(queries);
+    for (size_t i = 0; i < queries; ++i) {
+        starts[i] = (int) (rng() % keys.size());
+    }
+    long long sum = 0;
+    AVLBench::Timer count;
+    for (size_t i = 0; i < queries; ++i) {
+        sum += index.Count(starts[i], starts[i] + span - 1, distinct / 4, distinct / 4 + distinct / 2);
+    }
+    AVLBench::Report("  Count", queries, count.Seconds());
+
+    // The same counts by walking the key range on the tree (a scan per query, so on fewer queries).
+    const size_t scans = std::min(queries, (size_t) 2000);
+    long long check = 0;
+    AVLBench::Timer scan;
+    for (size_t i = 0; i < scans; ++i) {
+        AVL::Node<int, int, AVL::DefaultRank<int, int>> *node = tree.FindNode(starts[i]);
+        for (int k = 0; node && k < span; ++k, node = tree.Next(node)) {
+            check += node->value >= distinct / 4 && node->value <= distinct / 4 + distinct / 2;
+        }
+    }
+    AVLBench::Report("  scan of the key range", scans, scan.Seconds());
+    long long expected = 0;
+    for (size_t i = 0; i < scans; ++i) {
+        expected += index.Count(starts[i], starts[i] + span - 1, distinct / 4, distinct / 4 + distinct / 2);
+    }
+    printf("  counts %s\n", check == expected ? "match" : "MISMATCH");
+    AVLBench::Keep(sum);
+}
+
+int main(int argc, char **argv) {
+    const size_t count = std::max(AVLBench::ArgCount(argc, argv, 10000000), (size_t) 1);
+    const std::vector<int> keys = AVLBench::ShuffledKeys(count, 1);
+    Run(keys, 1024);
+    Run(keys, (int) std::min(count, (size_t) 1 << 30));
+    return 0;
+}
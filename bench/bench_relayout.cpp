@@ -0,0 +1,108 @@
+/**
+ * Relayout benchmark: range scans, full in-order walks and random lookups on a tree scattered by random churn,
+ * before and after Compact() and Compact(true).
+ *
+ * g++ -std=c++11 -O2 -pthread -I. bench/bench_relayout.cpp -o bench_relayout && ./bench_relayout [elements]
+ */
+
+#include "../avl.hpp"
+#include "bench_util.hpp"
+
+typedef AVL::AVLRankTree<int, int> Tree;
+
+/* Queries the 1000 keys following every start, returns the amount of collected elements. */
+static long long Scan(const Tree &tree, const std::vector<int> &starts) {
+    long long total = 0;
+    for (size_t i = 0; i < starts.size(); ++i) {
+        int min = starts[i];
+        int max = starts[i] + 999;
+        AVL::FilterObject<int, int, long long> filter;
+        filter.min_range = &min;
+        filter.max_range = &max;
+        total += tree.Query(filter).total;
+    }
+    return total;
+}
+
+/* Times the three access patterns into seconds[0..2]. */
+static void Measure(const char *name, Tree &tree, const std::vector<int> &starts, const std::vector<int> &lookups,
+                    double *seconds) {
+    printf("%s (height %lld)\n", name, (long long) tree.GetHeight());
+    long long sum = 0;
+
+    // Untimed pass: Query allocates its result chain, and the first allocations after a relayout pay for the
+    // allocator absorbing the freed nodes.
+    sum += Scan(tree, starts);
+    AVLBench::EvictCaches();
+    AVLBench::Timer scan;
+    sum += Scan(tree, starts);
+    seconds[0] = scan.Seconds();
+    AVLBench::Report("  Query of 1000 keys", starts.size(), seconds[0]);
+
+    AVLBench::EvictCaches();
+    AVLBench::Timer walk;
+    for (AVL::Node<int, int, AVL::DefaultRank<int, int>> *node = tree.FindIndexNode(0); node; node = tree.Next(node)) {
+        sum += node->value;
+    }
+    seconds[1] = walk.Seconds();
+    AVLBench::Report("  in-order walk (per node)", (size_t) tree.GetSize(), seconds[1]);
+
+    AVLBench::EvictCaches();
+    AVLBench::Timer find;
+    for (size_t i = 0; i < lookups.size(); ++i) {
+        sum += tree.FindNode(lookups[i])->value;
+    }
+    seconds[2] = find.Seconds();
+    AVLBench::Report("  FindNode", lookups.size(), seconds[2]);
+    AVLBench::Keep(sum);
+}
+
+static void Speedup(const double *before, const double *after) {
+    printf("  speedup: Query %.2fx, walk %.2fx, FindNode %.2fx\n", before[0] / after[0], before[1] / after[1],
+           before[2] / after[2]);
+}
+
+int main(int argc, char **argv) {
+    const size_t count = std::max(AVLBench::ArgCount(argc, argv, 4000000), (size_t) 2);
+    const std::vector<int> keys = AVLBench::ShuffledKeys(2 * count, 1);
+    Tree tree;
+    for (size_t i = 0; i < count; ++i) {
+        tree.Insert(keys[i], keys[i]);
+    }
+    // Random churn: remove a present key, insert an absent one, so the nodes end up scattered over the heap.
+    std::vector<int> present(keys.begin(), keys.begin() + count);
+    std::vector<int> absent(keys.begin() + count, keys.end());
+    std::mt19937 rng(2);
+    for (size_t i = 0; i < 2 * count; ++i) {
+        const size_t out = rng() % count;
+        const size_t in = rng() % count;
+        tree.Remove(present[out]);
+        tree.Insert(absent[in], absent[in]);
+        std::swap(present[out], absent[in]);
+    }
+
+    std::vector<int> starts(2000);
+    for (size_t i = 0; i < starts.size(); ++i) {
+        starts[i] = (int) (rng() % (2 * count));
+    }
+    std::vector<int> lookups(2000000);
+    for (size_t i = 0; i < lookups.size(); ++i) {
+        lookups[i] = present[rng() % count];
+    }
+
+    double scattered[3];
+    double compacted[3];
+    double rebuilt[3];
+    Measure("after churn", tree, starts, lookups, scattered);
+    AVLBench::Timer compact;
+    tree.Compact();
+    printf("Compact() %.0f ms\n", compact.Seconds() * 1e3);
+    Measure("compacted (vEB order)", tree, starts, lookups, compacted);
+    Speedup(scattered, compacted);
+    AVLBench::Timer rebuild;
+    tree.Compact(true);
+    printf("Compact(true) %.0f ms\n", rebuild.Seconds() * 1e3);
+    Measure("rebuilt to perfect balance (vEB order)", tree, starts, lookups, rebuilt);
+    Speedup(scattered, rebuilt);
+    return 0;
+}
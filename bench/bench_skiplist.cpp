@@ -0,0 +1,132 @@
+/**
+ * Concurrent skip list benchmark: mixed writes and quiescent rank reads from 1 to 64 threads, against an
+ * AVLRankTree behind a mutex.
+ *
+ * g++ -std=c++11 -O2 -pthread -I. bench/bench_skiplist.cpp -o bench_skiplist && ./bench_skiplist [elements]
+ */
+
+#include <mutex>
+#include <thread>
+#include "../avl_skiplist.hpp"
+#include "bench_util.hpp"
+
+/* AVLRankTree serialized by a mutex, with the operations of the skip list. */
+class LockedTree {
+private:
+    AVL::AVLRankTree<int, int> tree;
+    std::mutex mutex;
+
+public:
+    bool Insert(int key, int value) {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (this->tree.FindNode(key)) {
+            return false;
+        }
+        this->tree.Insert(key, value);
+        return true;
+    }
+
+    bool Remove(int key) {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (!this->tree.FindNode(key)) {
+            return false;
+        }
+        this->tree.Remove(key);
+        return true;
+    }
+
+    bool Find(int key, int &value) {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        const AVL::Node<int, int, AVL::DefaultRank<int, int>> *node = this->tree.FindNode(key);
+        if (!node) {
+            return false;
+        }
+        value = node->value;
+        return true;
+    }
+
+    long long GetIndexOfKey(int key) {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return this->tree.GetIndexOfKey(key);
+    }
+};
+
+/* Every thread runs `operations` steps: 50% Find, 25% Insert, 25% Remove of keys in [0, 2 * count). */
+template<class Set>
+static double Mixed(Set &set, unsigned threads, size_t count, size_t operations) {
+    std::vector<std::thread> workers;
+    AVLBench::Timer timer;
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.push_back(std::thread([&set, t, count, operations]() {
+            uint64_t state = 0x9E3779B97F4A7C15ULL * (t + 1);
+            long long found = 0;
+            for (size_t i = 0; i < operations; ++i) {
+                state ^= state << 13;
+                state ^= state >> 7;
+                state ^= state << 17;
+                const int key = (int) ((state >> 8) % (2 * count));
+                int value;
+                switch (state & 3) {
+                    case 0:
+                        set.Insert(key, key);
+                        break;
+                    case 1:
+                        set.Remove(key);
+                        break;
+                    default:
+                        found += set.Find(key, value);
+                }
+            }
+            AVLBench::Keep(found);
+        }));
+    }
+    for (unsigned t = 0; t < threads; ++t) {
+        workers[t].join();
+    }
+    return timer.Seconds();
+}
+
+/* Every thread runs `operations` GetIndexOfKey, no writer in progress. */
+template<class Set>
+static double Ranks(Set &set, unsigned threads, size_t count, size_t operations) {
+    std::vector<std::thread> workers;
+    AVLBench::Timer timer;
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.push_back(std::thread([&set, t, count, operations]() {
+            long long sum = 0;
+            for (size_t i = 0; i < operations; ++i) {
+                sum += set.GetIndexOfKey((int) (((i + t) * 2654435761u) % (2 * count)));
+            }
+            AVLBench::Keep(sum);
+        }));
+    }
+    for (unsigned t = 0; t < threads; ++t) {
+        workers[t].join();
+    }
+    return timer.Seconds();
+}
+
+int main(int argc, char **argv) {
+    const size_t count = std::max(AVLBench::ArgCount(argc, argv, 1000000), (size_t) 1);
+    const size_t operations = 2000000;
+    const std::vector<int> keys = AVLBench::ShuffledKeys(2 * count, 1);
+    AVL::ConcurrentSkipList<int, int> list;
+    LockedTree tree;
+    for (size_t i = 0; i < count; ++i) {
+        list.Insert(keys[i], keys[i]);
+        tree.Insert(keys[i], keys[i]);
+    }
+    for (unsigned threads = 1; threads <= 64; threads *= 2) {
+        printf("%u threads\n", threads);
+        const size_t each = operations / threads;
+        AVLBench::Report("  mixed ConcurrentSkipList", each * threads, Mixed(list, threads, count, each));
+        AVLBench::Report("  mixed mutex AVLRankTree", each * threads, Mixed(tree, threads, count, each));
+        // The first rank read after overlapping writers repairs the spans.
+        AVLBench::Timer repair;
+        AVLBench::Keep(list.GetIndexOfKey(0));
+        printf("  span repair %.3f ms\n", repair.Seconds() * 1e3);
+        AVLBench::Report("  GetIndexOfKey ConcurrentSkipList", each * threads, Ranks(list, threads, count, each));
+        AVLBench::Report("  GetIndexOfKey mutex AVLRankTree", each * threads, Ranks(tree, threads, count, each));
+    }
+    return 0;
+}
@@ -0,0 +1,50 @@
+/**
+ * Splay rank tree benchmark: Zipf(0.99) and uniform lookups on SplayRankTree against AVLRankTree.
+ *
+ * g++ -std=c++11 -O2 -pthread -I. bench/bench_splay.cpp -o bench_splay && ./bench_splay [elements]
+ */
+
+#include "../avl_splay.hpp"
+#include "bench_util.hpp"
+
+template<class Tree>
+static double Lookups(Tree &tree, const std::vector<int> &keys) {
+    AVLBench::Timer timer;
+    long long sum = 0;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        sum += tree.FindNode(keys[i])->value;
+    }
+    AVLBench::Keep(sum);
+    return timer.Seconds();
+}
+
+int main(int argc, char **argv) {
+    const size_t count = AVLBench::ArgCount(argc, argv, 1000000);
+    const std::vector<int> keys = AVLBench::ShuffledKeys(count, 1);
+    AVL::AVLRankTree<int, int> plain;
+    AVL::SplayRankTree<int, int> splay;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        plain.Insert(keys[i], keys[i]);
+        splay.Insert(keys[i], keys[i]);
+    }
+    const size_t draws = 4000000;
+    // Zipf ranks mapped through the shuffled keys, so the hot keys are spread over the whole key range.
+    std::vector<int> zipf = AVLBench::ZipfKeys(count, draws, 0.99, 2);
+    for (size_t i = 0; i < zipf.size(); ++i) {
+        zipf[i] = keys[zipf[i]];
+    }
+    std::vector<int> uniform(draws);
+    for (size_t i = 0; i < draws; ++i) {
+        uniform[i] = keys[(i * 2654435761u) % count];
+    }
+
+    AVLBench::Report("zipf 0.99 AVLRankTree::FindNode", draws, Lookups(plain, zipf));
+    AVLBench::Report("zipf 0.99 SplayRankTree::FindNode", draws, Lookups(splay, zipf));
+    printf("  splay height %lld (AVL %lld)\n", (long long) splay.GetHeight(), (long long) plain.GetHeight());
+    AVLBench::Report("uniform AVLRankTree::FindNode", draws, Lookups(plain, uniform));
+    AVLBench::Report("uniform SplayRankTree::FindNode", draws, Lookups(splay, uniform));
+    printf("  splay height %lld\n", (long long) splay.GetHeight());
+    const AVL::SplayRankTree<int, int> &frozen = splay;
+    AVLBench::Report("zipf 0.99 const SplayRankTree (no splay)", draws, Lookups(frozen, zipf));
+    return 0;
+}
@@ -0,0 +1,84 @@
+/**
+ * String key benchmark: insert and lookup throughput of StringRankTree (prefix cached, arena interned keys) against
+ * AVLRankTree<std::string>, on URL-like and UUID-like key sets.
+ *
+ * g++ -std=c++11 -O2 -pthread -I. bench/bench_string.cpp -o bench_string && ./bench_string [elements]
+ */
+
+#include <string>
+#include "../avl_string.hpp"
+#include "bench_util.hpp"
+
+/* URL-like keys: a few hosts and paths in common, the distinguishing part comes late. */
+static std::vector<std::string> UrlKeys(const std::vector<int> &ids) {
+    static const char *hosts[] = {"https://www.example.com", "https://api.example.org", "https://cdn.example.net"};
+    std::vector<std::string> keys(ids.size());
+    char buffer[128];
+    for (size_t i = 0; i < ids.size(); ++i) {
+        snprintf(buffer, sizeof(buffer), "%s/users/%d/posts/%d?ref=feed", hosts[ids[i] % 3], ids[i] / 97,
+                 ids[i] % 97);
+        keys[i] = buffer;
+    }
+    return keys;
+}
+
+/* UUID-like keys: 36 random hexadecimal characters and dashes. */
+static std::vector<std::string> UuidKeys(const std::vector<int> &ids) {
+    std::mt19937_64 rng(3);
+    std::vector<std::string> keys(ids.size());
+    char buffer[40];
+    for (size_t i = 0; i < ids.size(); ++i) {
+        const uint64_t high = rng();
+        const uint64_t low = rng();
+        snprintf(buffer, sizeof(buffer), "%08x-%04x-4%03x-%04x-%012llx", (unsigned) (high >> 32),
+                 (unsigned) (high >> 16) & 0xFFFF, (unsigned) high & 0xFFF, (unsigned) (low >> 48),
+                 (unsigned long long) (low & 0xFFFFFFFFFFFFULL));
+        keys[i] = buffer;
+    }
+    return keys;
+}
+
+static void Run(const char *name, const std::vector<std::string> &keys) {
+    printf("%s keys (e.g. %s)\n", name, keys[0].c_str());
+    std::vector<std::string> lookups(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        lookups[i] = keys[(i * 2654435761u) % keys.size()];
+    }
+    long long sum = 0;
+    {
+        AVL::AVLRankTree<std::string, int> tree;
+        AVLBench::Timer insert;
+        for (size_t i = 0; i < keys.size(); ++i) {
+            tree.Insert(keys[i], (int) i);
+        }
+        AVLBench::Report("  AVLRankTree<std::string> insert", keys.size(), insert.Seconds());
+        AVLBench::Timer find;
+        for (size_t i = 0; i < lookups.size(); ++i) {
+            sum += tree.FindNode(lookups[i])->value;
+        }
+        AVLBench::Report("  AVLRankTree<std::string> FindNode", lookups.size(), find.Seconds());
+    }
+    {
+        AVL::StringKeyArena arena;
+        AVL::StringRankTree<int> tree;
+        AVLBench::Timer insert;
+        for (size_t i = 0; i < keys.size(); ++i) {
+            tree.Insert(arena.Intern(keys[i]), (int) i);
+        }
+        AVLBench::Report("  StringRankTree insert (interned)", keys.size(), insert.Seconds());
+        AVLBench::Timer find;
+        for (size_t i = 0; i < lookups.size(); ++i) {
+            sum += tree.FindNode(AVL::StringKey(lookups[i]))->value;
+        }
+        AVLBench::Report("  StringRankTree FindNode", lookups.size(), find.Seconds());
+    }
+    AVLBench::Keep(sum);
+}
+
+int main(int argc, char **argv) {
+    const size_t count = std::max(AVLBench::ArgCount(argc, argv, 1000000), (size_t) 1);
+    const std::vector<int> ids = AVLBench::ShuffledKeys(count, 1);
+    Run("URL", UrlKeys(ids));
+    Run("UUID", UuidKeys(ids));
+    return 0;
+}
@@ -0,0 +1,148 @@
+/**
+ * Benchmark helpers.
+ *
+ * @file bench_util.hpp
+ *
+ * @brief Timer, key generation and reporting shared by the benchmarks.
+ *
+ * @author Liav Barsheshet
+ * Contact: liavbarsheshet@gmail.com
+ *
+ * This implementation is free: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This implementation is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#ifndef _AVL_BENCH_UTIL_HPP
+#define _AVL_BENCH_UTIL_HPP
+
+namespace AVLBench {
+    /**
+     * Class: Wall clock timer, started on construction.
+     */
+    class Timer {
+    private:
+        std::chrono::steady_clock::time_point start;
+
+    public:
+        Timer() :
+                start(std::chrono::steady_clock::now()) {}
+
+        double Seconds() const {
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - this->start).count();
+        }
+    };
+
+    /* Distinct keys [0, count) in a random order. */
+    inline std::vector<int> ShuffledKeys(size_t count, unsigned seed) {
+        std::vector<int> keys(count);
+        for (size_t i = 0; i < count; ++i) {
+            keys[i] = (int) i;
+        }
+        std::shuffle(keys.begin(), keys.end(), std::mt19937(seed));
+        return keys;
+    }
+
+    /* Smallest bit count whose range [0, 2^bits) holds `count` keys. */
+    inline unsigned KeyBits(size_t count) {
+        unsigned bits = 1;
+        while (((size_t) 1 << bits) < count) {
+            ++bits;
+        }
+        return bits;
+    }
+
+    /* Bijection of [0, 2^bits): PermutedKey(0) .. PermutedKey(count - 1) are distinct keys spread over the range. */
+    inline int PermutedKey(size_t index, unsigned bits) {
+        return (int) ((index * 2654435761u) & (((size_t) 1 << bits) - 1));
+    }
+
+    /* Uniform draws among the keys PermutedKey(0) .. PermutedKey(count - 1). */
+    inline std::vector<int> PermutedDraws(size_t count, size_t draws, unsigned seed) {
+        const unsigned bits = KeyBits(count);
+        std::mt19937_64 rng(seed);
+        std::vector<int> keys(draws);
+        for (size_t i = 0; i < draws; ++i) {
+            keys[i] = PermutedKey((size_t) (rng() % count), bits);
+        }
+        return keys;
+    }
+
+    /* Keys drawn from a Zipf distribution of exponent s over [0, count), by inverting the cumulative weights. */
+    inline std::vector<int> ZipfKeys(size_t count, size_t draws, double s, unsigned seed) {
+        std::vector<double> cumulative(count);
+        double total = 0;
+        for (size_t i = 0; i < count; ++i) {
+            total += 1.0 / std::pow((double) (i + 1), s);
+            cumulative[i] = total;
+        }
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<double> uniform(0, total);
+        std::vector<int> keys(draws);
+        for (size_t i = 0; i < draws; ++i) {
+            const double weight = uniform(rng);
+            keys[i] = (int) (std::lower_bound(cumulative.begin(), cumulative.end(), weight) - cumulative.begin());
+        }
+        return keys;
+    }
+
+    /* Streams over a buffer larger than the last level cache, so the next measured accesses start cold. */
+    inline void EvictCaches() {
+        static std::vector<char> buffer((size_t) 512 << 20);
+        long long sum = 0;
+        for (size_t i = 0; i < buffer.size(); i += 64) {
+            buffer[i] = (char) (buffer[i] + 1);
+            sum += buffer[i];
+        }
+        volatile long long sink = sum;
+        (void) sink;
+    }
+
+    /* Resident memory of the process in bytes (Linux), 0 where it cannot be read. */
+    inline long long ResidentBytes() {
+        long long pages = 0;
+        long long resident = 0;
+        FILE *statm = fopen("/proc/self/statm", "r");
+        if (!statm) {
+            return 0;
+        }
+        if (fscanf(statm, "%lld %lld", &pages, &resident) != 2) {
+            resident = 0;
+        }
+        fclose(statm);
+        return resident * 4096;
+    }
+
+    /* Element count from the first command line argument, or a default. */
+    inline size_t ArgCount(int argc, char **argv, size_t fallback) {
+        return argc > 1 ? (size_t) strtoull(argv[1], NULL, 10) : fallback;
+    }
+
+    /* Keeps a result alive, so the measured work is not optimized away. */
+    template<typename T>
+    inline void Keep(const T &value) {
+        volatile T sink = value;
+        (void) sink;
+    }
+
+    inline void Report(const char *name, size_t operations, double seconds) {
+        printf("%-44s %10.1f ns/op %10.2f Mops/s\n", name, seconds * 1e9 / (double) operations,
+               (double) operations / seconds / 1e6);
+    }
+}
+
+#endif